@@ -4,6 +4,55 @@
 #include <sstream>
 #include <stdexcept>
 #include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <queue>
+#include <vector>
+#include <unordered_map>
+#include <limits>
+#include <functional>
+#include <charconv>
+#include <complex>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+// OpenMP directive which is dropped without a warning when compiling without OpenMP
+#ifdef _OPENMP
+#define MATFILE_OMP(...) _Pragma(#__VA_ARGS__)
+#else
+#define MATFILE_OMP(...)
+#endif
+#ifdef MATFILE_USE_LIBURING
+#include <liburing.h>
+#endif
+#ifdef MATFILE_USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef MATFILE_USE_ZSTD
+#include <zstd.h>
+#endif
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define MATFILE_ENABLE_F16C
+#define MATFILE_ENABLE_SSE42
+#define MATFILE_ENABLE_AVX2
+#endif
 
 namespace mtk {
 namespace matfile {
@@ -18,10 +67,14 @@ enum class data_t {
 	uint64,
 	fp32,
 	fp64,
-	fp128
+	fp128,
+	fp16,
+	bf16
 };
 enum class matrix_t {
-	dense
+	dense,
+	csr,
+	csc
 };
 
 enum class op_t {
@@ -29,7 +82,165 @@ enum class op_t {
 	no_transpose
 };
 
+enum class codec_t {
+	none = 0,
+	// LZ77 codec implemented in this library
+	builtin = 1,
+	// Available when MATFILE_USE_LZ4 / MATFILE_USE_ZSTD is defined
+	lz4 = 2,
+	zstd = 3
+};
+
+// Lossless filter applied to each chunk before compression
+enum class filter_t {
+	none = 0,
+	// Store the k-th bytes of all elements contiguously
+	shuffle = 1,
+	// XOR each element with the previous one in the same column, then shuffle
+	xor_shuffle = 2
+};
+
+// Checksum of each column chunk stored in the trailer of a dense file
+enum class checksum_t {
+	none = 0,
+	crc32c = 1
+};
+
+// Lossy quantization of fp32/fp64 payloads
+enum class quantize_t {
+	none = 0,
+	// 8-bit / 4-bit unsigned codes with an offset and a scale per block
+	int8 = 1,
+	int4 = 2
+};
+
+// Conversion applied when the in-memory type differs from the file type
+enum class convert_t {
+	// Plain static_cast (out-of-range values are implementation-defined or undefined)
+	cast = 0,
+	// Clamp to the range of an integer destination type, NaN becomes 0
+	saturate = 1,
+	// Round to the nearest integer (ties to even) before saturating
+	round_saturate = 2
+};
+
+struct io_options {
+	// The number of threads used for reading/writing and converting the payload.
+	// Column panels are distributed over OpenMP threads with pread/pwrite when this is larger than 1.
+	unsigned num_threads = 1;
+
+	// Bypass the page cache with O_DIRECT using aligned staging buffers.
+	// The payload is then transferred by a single thread regardless of num_threads.
+	bool direct_io = false;
+
+	// Store the payload as independently compressed column chunks (save only).
+	// `chunk_cols` is the number of columns per chunk, and 0 selects chunks of a few MiB.
+	codec_t codec = codec_t::none;
+	std::uint64_t chunk_cols = 0;
+
+	// Filter applied to each chunk before compression (save only)
+	filter_t filter = filter_t::none;
+
+	// Conversion of the elements between the in-memory type and the file type
+	convert_t convert = convert_t::cast;
+
+	// Quantize the payload of fp32/fp64 files (save only, lossy).
+	// `quantize_block` is the number of rows sharing an offset and a scale, and 0 selects the whole column.
+	// The codes are rounded stochastically when `stochastic_rounding` is true and to the nearest otherwise.
+	quantize_t quantize = quantize_t::none;
+	std::uint64_t quantize_block = 0;
+	bool stochastic_rounding = false;
+	// Store a checksum per chunk of `chunk_cols` columns (save only).
+	// Loads verify the chunks they read and throw on a mismatch.
+	checksum_t checksum = checksum_t::none;
+};
+
+namespace detail {
+inline std::uint32_t get_float_bits(const float v) {
+	std::uint32_t u;
+	std::memcpy(&u, &v, sizeof(u));
+	return u;
+}
+
+inline float get_float_from_bits(const std::uint32_t u) {
+	float v;
+	std::memcpy(&v, &u, sizeof(v));
+	return v;
+}
+
+// IEEE binary16 conversions with round-to-nearest-even (F. Giesen's branch-light version)
+inline std::uint16_t float_to_half_bits(const float v) {
+	auto f = get_float_bits(v);
+	const auto sign = f & 0x80000000u;
+	f ^= sign;
+	std::uint32_t o;
+	if (f >= 0x47800000u) {
+		// Inf, NaN and |v| >= 65536
+		o = f > 0x7f800000u ? (0x7e00u | ((f >> 13) & 0x3ffu)) : 0x7c00u;
+	} else if (f < 0x38800000u) {
+		// Subnormal or zero. The FP adder rounds the mantissa.
+		o = get_float_bits(get_float_from_bits(f) + 0.5f) - 0x3f000000u;
+	} else {
+		const auto mant_odd = (f >> 13) & 1u;
+		f += 0xc8000fffu + mant_odd;
+		o = f >> 13;
+	}
+	return static_cast<std::uint16_t>(o | (sign >> 16));
+}
+
+inline float half_bits_to_float(const std::uint16_t h) {
+	constexpr std::uint32_t shifted_exp = 0x7c00u << 13;
+	auto o = static_cast<std::uint32_t>(h & 0x7fffu) << 13;
+	const auto exp = shifted_exp & o;
+	o += (127u - 15u) << 23;
+	if (exp == shifted_exp) {
+		// Inf and NaN. NaN is made quiet as F16C does.
+		o += (128u - 16u) << 23;
+		o |= (h & 0x3ffu) != 0 ? 0x400000u : 0u;
+	} else if (exp == 0) {
+		// Subnormal
+		o = get_float_bits(get_float_from_bits(o + (1u << 23)) - get_float_from_bits(113u << 23));
+	}
+	return get_float_from_bits(o | (static_cast<std::uint32_t>(h & 0x8000u) << 16));
+}
+
+inline std::uint16_t float_to_bfloat16_bits(const float v) {
+	const auto f = get_float_bits(v);
+	if ((f & 0x7fffffffu) > 0x7f800000u) {
+		// Keep NaN quiet
+		return static_cast<std::uint16_t>((f >> 16) | 0x40u);
+	}
+	return static_cast<std::uint16_t>((f + 0x7fffu + ((f >> 16) & 1u)) >> 16);
+}
+
+inline float bfloat16_bits_to_float(const std::uint16_t h) {
+	return get_float_from_bits(static_cast<std::uint32_t>(h) << 16);
+}
+} // namespace detail
+
+// 16-bit floating point storage types. Arithmetic is done after converting to float.
+struct half {
+	std::uint16_t bits;
+
+	half() = default;
+	explicit half(const float v) : bits(detail::float_to_half_bits(v)) {}
+	operator float() const {return detail::half_bits_to_float(bits);}
+};
+
+struct bfloat16 {
+	std::uint16_t bits;
+
+	bfloat16() = default;
+	explicit bfloat16(const float v) : bits(detail::float_to_bfloat16_bits(v)) {}
+	operator float() const {return detail::bfloat16_bits_to_float(bits);}
+};
+
 namespace detail {
+template <class T>
+struct is_16bit_float : std::false_type {};
+template <> struct is_16bit_float<half    > : std::true_type {};
+template <> struct is_16bit_float<bfloat16> : std::true_type {};
+
 struct file_header {
 #ifndef MATFILE_USE_OLD_FORMAT
 	std::uint32_t version;
@@ -58,6 +269,8 @@ template <> inline data_t get_data_type<std::uint64_t>() {return data_t::uint64;
 template <> inline data_t get_data_type<std::uint32_t>() {return data_t::uint32;};
 template <> inline data_t get_data_type<std::uint16_t>() {return data_t::uint16;};
 template <> inline data_t get_data_type<std::uint8_t >() {return data_t::uint8 ;};
+template <> inline data_t get_data_type<half         >() {return data_t::fp16  ;};
+template <> inline data_t get_data_type<bfloat16     >() {return data_t::bf16  ;};
 
 inline std::string get_data_type_str(const data_t data_t) {
 	switch (data_t) {
@@ -72,12 +285,49 @@ inline std::string get_data_type_str(const data_t data_t) {
 	case data_t::uint32: return "uint32_t"   ;
 	case data_t::uint16: return "uint16_t"   ;
 	case data_t::uint8 : return "uint8_t"    ;
+	case data_t::fp16  : return "half"       ;
+	case data_t::bf16  : return "bfloat16"   ;
 	default:
 		break;
 	}
 	return "Unknown";
 }
 
+template <class T>
+struct type_tag {
+	using type = T;
+};
+
+// Call `func` with the type_tag of the C++ type corresponding to `dtype`
+template <class Func>
+inline void dispatch_data_type(
+		const data_t dtype,
+		Func func
+		) {
+	switch (dtype) {
+#define MATFILE_DISPATCH_CODE(MATFILE_T, data_type) \
+	case data_t::data_type: \
+		func(type_tag<MATFILE_T>{}); \
+		break
+		MATFILE_DISPATCH_CODE(long double, fp128);
+		MATFILE_DISPATCH_CODE(double, fp64);
+		MATFILE_DISPATCH_CODE(float, fp32);
+		MATFILE_DISPATCH_CODE(std::uint8_t , uint8);
+		MATFILE_DISPATCH_CODE(std::uint16_t, uint16);
+		MATFILE_DISPATCH_CODE(std::uint32_t, uint32);
+		MATFILE_DISPATCH_CODE(std::uint64_t, uint64);
+		MATFILE_DISPATCH_CODE(std::int8_t , int8);
+		MATFILE_DISPATCH_CODE(std::int16_t, int16);
+		MATFILE_DISPATCH_CODE(std::int32_t, int32);
+		MATFILE_DISPATCH_CODE(std::int64_t, int64);
+		MATFILE_DISPATCH_CODE(half    , fp16);
+		MATFILE_DISPATCH_CODE(bfloat16, bf16);
+#undef MATFILE_DISPATCH_CODE
+	default:
+		break;
+	}
+}
+
 template <class T>
 inline std::string get_type_name_str() {
 	return get_data_type_str(get_data_type<T>());
@@ -103,21 +353,56 @@ inline std::uint32_t get_major_version(
 }
 } // namespace detail
 
-inline detail::file_header load_header(
-		const std::string mat_name
+namespace detail {
+// Read the header with a single pread. False when the file cannot be opened or is too short.
+inline bool read_header(
+		const std::string& mat_name,
+		file_header& header
 		) {
-	std::ifstream ifs(mat_name, std::ios::binary);
-	if (!ifs) {
-		throw std::runtime_error("[matfile error] No such file : " + mat_name);
+	const int fd = open(mat_name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
 	}
+	const auto s = pread(fd, &header, sizeof(header), 0);
+	close(fd);
+	return s == static_cast<ssize_t>(sizeof(header));
+}
+} // namespace detail
 
+inline detail::file_header load_header(
+		const std::string mat_name
+		) {
 	detail::file_header file_header;
-	ifs.read(reinterpret_cast<char*>(&file_header), sizeof(file_header));
-	ifs.close();
+	if (!detail::read_header(mat_name, file_header)) {
+		if (access(mat_name.c_str(), F_OK) != 0) {
+			throw std::runtime_error("[matfile error] No such file : " + mat_name);
+		}
+		throw std::runtime_error("[matfile error] Failed to read : " + mat_name);
+	}
 
 	return file_header;
 }
 
+// Load the headers of many files concurrently on `num_threads` threads
+inline std::vector<detail::file_header> load_headers(
+		const std::vector<std::string>& mat_names,
+		[[maybe_unused]] const unsigned num_threads = 1
+		) {
+	const std::int64_t num_files = mat_names.size();
+	std::vector<detail::file_header> headers(num_files);
+	std::vector<std::uint8_t> failed(num_files, 0);
+MATFILE_OMP(omp parallel for schedule(dynamic, 16) num_threads(std::max(1u, num_threads)))
+	for (std::int64_t i = 0; i < num_files; i++) {
+		failed[i] = !detail::read_header(mat_names[i], headers[i]);
+	}
+	for (std::int64_t i = 0; i < num_files; i++) {
+		if (failed[i]) {
+			throw std::runtime_error("[matfile error] Failed to read : " + mat_names[i]);
+		}
+	}
+	return headers;
+}
+
 template <class INT_T>
 inline void load_matrix_size(
 		INT_T& m,
@@ -163,256 +448,4275 @@ inline std::size_t get_dtype_size(
 	case data_t::fp32: return 4;
 	case data_t::fp64: return 8;
 	case data_t::fp128: return 16;
+	case data_t::fp16: return 2;
+	case data_t::bf16: return 2;
 	default: break;
 	}
 	return 0;
 }
 
 namespace detail {
-template <class T, class MATFILE_T>
-void load_dense_core(
-		T* const ptr,
-		std::ifstream& ifs,
+// Size of the staging buffer used when the payload has to be converted or reordered
+constexpr std::size_t io_buffer_size = 1lu << 23;
+
+template <class MATFILE_T>
+inline std::size_t get_panel_width(
+		const std::size_t m
+		) {
+	return std::max<std::size_t>(1, io_buffer_size / (std::max<std::size_t>(1, m) * sizeof(MATFILE_T)));
+}
+
+// Tile size of the blocked transpose in scatter_panel/gather_panel
+constexpr std::size_t transpose_tile_size = 32;
+
+template <class MATFILE_T>
+inline std::size_t get_panel_width(
 		const std::size_t m,
-		const std::size_t n,
-		const std::uint64_t ld,
 		const op_t op
 		) {
-	for (std::uint64_t j = 0; j < n; j++) {
-		for (std::uint64_t i = 0; i < m; i++) {
-			std::size_t index;
-			if (op == op_t::no_transpose) {
-				index = i + j * ld;
-			} else {
-				index = j + i * ld;
-			}
-			MATFILE_T v;
-			ifs.read(reinterpret_cast<char*>(&v), sizeof(T));
-			ptr[index] = v;
-		}
+	// A transposed panel needs at least one tile of columns so that the writes to the destination are contiguous
+	if (op == op_t::transpose) {
+		return std::max(get_panel_width<MATFILE_T>(m), transpose_tile_size);
 	}
+	return get_panel_width<MATFILE_T>(m);
 }
 
-} // namespace detail
+// Build the bulk conversion loops for AVX-512, AVX2 and the baseline ISA and select one at load time
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define MATFILE_TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define MATFILE_TARGET_CLONES
+#endif
 
-template <class T>
-void load_dense(
-		T* const mat_ptr,
-		const std::uint64_t ld,
-		const std::string mat_name,
-		const op_t op = op_t::no_transpose
+// Keep a * b + c as two roundings so that the vectorized body and the scalar remainder of a loop give the same bits
+#if defined(__GNUC__) && !defined(__clang__)
+#define MATFILE_NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+#define MATFILE_NO_FP_CONTRACT
+#endif
+
+template <class DST, class SRC>
+inline DST saturate_value(
+		const SRC v
 		) {
-	std::ifstream ifs(mat_name, std::ios::binary);
-	if (!ifs) {
-		throw std::runtime_error("[matfile error] No such file : " + mat_name);
+	if constexpr (std::is_integral<DST>::value && std::is_floating_point<SRC>::value) {
+		constexpr auto dst_min = std::numeric_limits<DST>::min();
+		constexpr auto dst_max = std::numeric_limits<DST>::max();
+		// max + 1 is a power of two and therefore exact in SRC
+		constexpr auto upper = static_cast<SRC>(dst_max / 2 + 1) * 2;
+		return v != v ? DST(0) : v <= static_cast<SRC>(dst_min) ? dst_min : v >= upper ? dst_max : static_cast<DST>(v);
+	} else if constexpr (std::is_integral<DST>::value && std::is_integral<SRC>::value) {
+		constexpr auto dst_min = std::numeric_limits<DST>::min();
+		constexpr auto dst_max = std::numeric_limits<DST>::max();
+		constexpr bool clamp_upper = std::numeric_limits<DST>::digits < std::numeric_limits<SRC>::digits;
+		constexpr bool clamp_lower = std::is_signed<SRC>::value && (!std::is_signed<DST>::value || clamp_upper);
+		if constexpr (clamp_upper && clamp_lower) {
+			return v < static_cast<SRC>(dst_min) ? dst_min : v > static_cast<SRC>(dst_max) ? dst_max : static_cast<DST>(v);
+		} else if constexpr (clamp_upper) {
+			return v > static_cast<SRC>(dst_max) ? dst_max : static_cast<DST>(v);
+		} else if constexpr (clamp_lower) {
+			return v < 0 ? DST(0) : static_cast<DST>(v);
+		} else {
+			return static_cast<DST>(v);
+		}
+	} else {
+		return static_cast<DST>(v);
 	}
+}
 
-	detail::file_header file_header;
-	ifs.read(reinterpret_cast<char*>(&file_header), sizeof(file_header));
-
-	const std::uint64_t m = file_header.m;
-	const std::uint64_t n = file_header.n;
-	const auto dtype = file_header.data_type;
+template <convert_t MODE, class DST, class SRC>
+inline DST convert_value(
+		const SRC v
+		) {
+	if constexpr (is_16bit_float<SRC>::value) {
+		// fp16/bf16 are widened to float, which represents them exactly
+		return convert_value<MODE, DST>(static_cast<float>(v));
+	} else if constexpr (is_16bit_float<DST>::value) {
+		// Wider types are rounded to float first
+		return DST(static_cast<float>(v));
+	} else if constexpr (MODE == convert_t::cast) {
+		return static_cast<DST>(v);
+	} else if constexpr (MODE == convert_t::round_saturate && std::is_integral<DST>::value && std::is_floating_point<SRC>::value) {
+		return saturate_value<DST>(std::nearbyint(v));
+	} else {
+		return saturate_value<DST>(v);
+	}
+}
 
-	switch (dtype) {
-#define LOAD_DENSE_CODE(MATFILE_T, data_type) \
-	case data_t::data_type: \
-		detail::load_dense_core<T, MATFILE_T>(mat_ptr, ifs, m, n, ld, op); \
-		break
-		LOAD_DENSE_CODE(long double, fp128);
-		LOAD_DENSE_CODE(double, fp64);
-		LOAD_DENSE_CODE(float, fp32);
-		LOAD_DENSE_CODE(std::uint8_t , uint8);
-		LOAD_DENSE_CODE(std::uint16_t, uint16);
-		LOAD_DENSE_CODE(std::uint32_t, uint32);
-		LOAD_DENSE_CODE(std::uint64_t, uint64);
-		LOAD_DENSE_CODE(std::int8_t , int8);
-		LOAD_DENSE_CODE(std::int16_t, int16);
-		LOAD_DENSE_CODE(std::int32_t, int32);
-		LOAD_DENSE_CODE(std::int64_t, int64);
+// Call `func` with std::integral_constant<convert_t, convert>
+template <class Func>
+inline void dispatch_convert(
+		const convert_t convert,
+		Func func
+		) {
+	switch (convert) {
+	case convert_t::saturate:
+		func(std::integral_constant<convert_t, convert_t::saturate>{});
+		break;
+	case convert_t::round_saturate:
+		func(std::integral_constant<convert_t, convert_t::round_saturate>{});
+		break;
 	default:
+		func(std::integral_constant<convert_t, convert_t::cast>{});
 		break;
 	}
-
-	ifs.close();
 }
 
-template <class T, class MATFILE_T = T>
-void save_dense(
-		const std::uint64_t m,
-		const std::uint64_t n,
-		const T* const mat_ptr,
-		const std::uint64_t ld,
-		const std::string mat_name,
-		const op_t op = op_t::no_transpose
+template <convert_t MODE, class DST, class SRC>
+MATFILE_TARGET_CLONES
+void convert_array_kernel(
+		DST* __restrict__ const dst,
+		const SRC* __restrict__ const src,
+		const std::size_t count
 		) {
-	detail::file_header file_header;
-	file_header.data_type = detail::get_data_type<MATFILE_T>();
-	file_header.m = m;
-	file_header.n = n;
-	file_header.matrix_type = matrix_t::dense;
-#ifndef MATFILE_USE_OLD_FORMAT
-	file_header.version = detail::get_version_uint32(0, 7);
-#endif
-
-	std::ofstream ofs(mat_name, std::ios::binary);
-	ofs.write(reinterpret_cast<char*>(&file_header), sizeof(file_header));
-
-	for (std::uint64_t j = 0; j < n; j++) {
-		for (std::uint64_t i = 0; i < m; i++) {
-			std::size_t index;
-			if (op == op_t::no_transpose) {
-				index = i + j * ld;
-			} else {
-				index = j + i * ld;
-			}
-			const MATFILE_T v = mat_ptr[index];
-			ofs.write(reinterpret_cast<const char*>(&v), sizeof(MATFILE_T));
-		}
+MATFILE_OMP(omp simd)
+	for (std::size_t i = 0; i < count; i++) {
+		dst[i] = convert_value<MODE, DST>(src[i]);
 	}
-	ofs.close();
 }
 
+#ifdef MATFILE_ENABLE_F16C
+inline bool has_f16c() {
+	static const bool supported = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+	return supported;
+}
 
-namespace matrix_market {
-namespace detail {
-using matrix_type_t = unsigned;
-constexpr matrix_type_t unsupported_matrix = 0;
-constexpr matrix_type_t general_matrix   = 1;
-constexpr matrix_type_t symmetric_matrix = 2;
-
-using element_type_t = unsigned;
-constexpr element_type_t unsupported_value = 0;
-constexpr element_type_t real_value = 1;
-constexpr element_type_t pattern_value = 2;
-
-inline matrix_type_t get_matrix_type(
-		const std::string banner
+__attribute__((target("avx,f16c")))
+inline void convert_float_to_half_f16c(
+		half* const dst,
+		const float* const src,
+		const std::size_t count
 		) {
-	if (banner.find("general") != std::string::npos) {
-		return general_matrix;
-	} else if (banner.find("symmetric") != std::string::npos) {
-		return symmetric_matrix;
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+	}
+	for (; i < count; i++) {
+		dst[i] = half(src[i]);
 	}
-	return unsupported_matrix;
 }
 
-inline element_type_t get_element_type(
-		const std::string banner
+__attribute__((target("avx,f16c")))
+inline void convert_half_to_float_f16c(
+		float* const dst,
+		const half* const src,
+		const std::size_t count
 		) {
-	if (banner.find("real") != std::string::npos) {
-		return real_value;
-	} else if (banner.find("pattern") != std::string::npos) {
-		return pattern_value;
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+	}
+	for (; i < count; i++) {
+		dst[i] = static_cast<float>(src[i]);
 	}
-	return unsupported_value;
 }
-} // unnamed namespace
+#endif
 
-template <class INT_T>
-void load_matrix_size(
-		INT_T& m,
-		INT_T& n,
-		const std::string filepath
+// Convert `count` contiguous elements. `dst` and `src` must not overlap.
+template <class DST, class SRC>
+inline void convert_array(
+		DST* const dst,
+		const SRC* const src,
+		const std::size_t count,
+		const convert_t convert
 		) {
-	std::ifstream ifs(filepath);
-
-	if (!ifs) {
-		throw std::runtime_error("[matfile error] No such file : " + filepath);
+	if constexpr (std::is_same<DST, SRC>::value) {
+		std::memcpy(dst, src, count * sizeof(DST));
+	} else {
+#ifdef MATFILE_ENABLE_F16C
+		// fp32 <-> fp16 with the F16C instructions when the CPU has them
+		if constexpr (std::is_same<DST, half>::value && std::is_same<SRC, float>::value) {
+			if (has_f16c()) {
+				convert_float_to_half_f16c(dst, src, count);
+				return;
+			}
+		} else if constexpr (std::is_same<DST, float>::value && std::is_same<SRC, half>::value) {
+			if (has_f16c()) {
+				convert_half_to_float_f16c(dst, src, count);
+				return;
+			}
+		}
+#endif
+		dispatch_convert(convert, [&](const auto mode) {
+			convert_array_kernel<decltype(mode)::value>(dst, src, count);
+		});
 	}
+}
 
-	std::string line;
-	while (std::getline(ifs, line)) {
-		if (line[0] != '%') {
-			break;
+// Copy a column-major panel `src` (rows x cols, leading dimension src_ld) to `dst`
+template <class T, class MATFILE_T>
+inline void scatter_panel(
+		T* const dst,
+		const std::uint64_t ld,
+		const MATFILE_T* const src,
+		const std::size_t src_ld,
+		const std::size_t rows,
+		const std::size_t cols,
+		const op_t op,
+		const convert_t convert
+		) {
+	if (op == op_t::no_transpose) {
+		if (ld == rows && src_ld == rows) {
+			convert_array(dst, src, rows * cols, convert);
+			return;
+		}
+		for (std::size_t j = 0; j < cols; j++) {
+			convert_array(dst + j * ld, src + j * src_ld, rows, convert);
 		}
+		return;
 	}
-	std::size_t num_elements;
-
-	std::stringstream ss(line);
-	ss >> m >> n >> num_elements;
 
-	ifs.close();
+	dispatch_convert(convert, [&](const auto mode) {
+		for (std::size_t jj = 0; jj < cols; jj += transpose_tile_size) {
+			const auto j_end = std::min(jj + transpose_tile_size, cols);
+			for (std::size_t ii = 0; ii < rows; ii += transpose_tile_size) {
+				const auto i_end = std::min(ii + transpose_tile_size, rows);
+				for (std::size_t i = ii; i < i_end; i++) {
+					for (std::size_t j = jj; j < j_end; j++) {
+						dst[j + i * ld] = convert_value<decltype(mode)::value, T>(src[i + j * src_ld]);
+					}
+				}
+			}
+		}
+	});
 }
 
-template <class INT_T = std::size_t>
-std::pair<INT_T, INT_T> load_matrix_size(
-		const std::string filepath
+// The inverse of scatter_panel
+template <class T, class MATFILE_T>
+inline void gather_panel(
+		MATFILE_T* const dst,
+		const std::size_t dst_ld,
+		const T* const src,
+		const std::uint64_t ld,
+		const std::size_t rows,
+		const std::size_t cols,
+		const op_t op,
+		const convert_t convert
 		) {
-	std::size_t m, n;
-	load_matrix_size(m, n, filepath);
+	if (op == op_t::no_transpose) {
+		if (ld == rows && dst_ld == rows) {
+			convert_array(dst, src, rows * cols, convert);
+			return;
+		}
+		for (std::size_t j = 0; j < cols; j++) {
+			convert_array(dst + j * dst_ld, src + j * ld, rows, convert);
+		}
+		return;
+	}
 
-	return std::pair<INT_T, INT_T>{m, n};
+	dispatch_convert(convert, [&](const auto mode) {
+		for (std::size_t jj = 0; jj < cols; jj += transpose_tile_size) {
+			const auto j_end = std::min(jj + transpose_tile_size, cols);
+			for (std::size_t ii = 0; ii < rows; ii += transpose_tile_size) {
+				const auto i_end = std::min(ii + transpose_tile_size, rows);
+				for (std::size_t j = jj; j < j_end; j++) {
+					for (std::size_t i = ii; i < i_end; i++) {
+						dst[i + j * dst_ld] = convert_value<decltype(mode)::value, MATFILE_T>(src[j + i * ld]);
+					}
+				}
+			}
+		}
+	});
 }
 
-template <class T>
-void load_matrix(
-		T* const ptr,
-		const std::size_t ld,
-		const std::string filepath,
-		const bool fill_zero = true
+template <class MATFILE_T>
+inline file_header make_dense_header(
+		const std::uint64_t m,
+		const std::uint64_t n
 		) {
-	std::ifstream ifs(filepath);
+	file_header header{};
+	header.data_type = get_data_type<MATFILE_T>();
+	header.m = m;
+	header.n = n;
+	header.matrix_type = matrix_t::dense;
+#ifndef MATFILE_USE_OLD_FORMAT
+	header.version = get_version_uint32(0, 7);
+#endif
+	return header;
+}
 
-	if (!ifs) {
-		throw std::runtime_error("[matfile error] No such file : " + filepath);
+template <class T, class MATFILE_T>
+void save_dense_core(
+		std::ofstream& ofs,
+		const T* const ptr,
+		const std::size_t m,
+		const std::size_t n,
+		const std::uint64_t ld,
+		const op_t op,
+		const convert_t convert
+		) {
+	if constexpr (std::is_same<T, MATFILE_T>::value) {
+		if (op == op_t::no_transpose) {
+			if (ld == m) {
+				ofs.write(reinterpret_cast<const char*>(ptr), m * n * sizeof(T));
+			} else {
+				for (std::uint64_t j = 0; j < n; j++) {
+					ofs.write(reinterpret_cast<const char*>(ptr + j * ld), m * sizeof(T));
+				}
+			}
+			return;
+		}
 	}
 
-	std::string line;
-	std::getline(ifs, line);
-
-	const auto matrix_type = detail::get_matrix_type(line);
-	if (matrix_type == detail::unsupported_matrix) {
-		throw std::runtime_error("Unsupported matrix type : banner = " + line);
-	}
-	const auto element_type = detail::get_element_type(line);
-	if (matrix_type == detail::unsupported_matrix) {
-		throw std::runtime_error("Unsupported element type : banner = " + line);
+	const auto panel_width = get_panel_width<MATFILE_T>(m, op);
+	std::unique_ptr<MATFILE_T[]> buffer(new MATFILE_T[m * std::min<std::size_t>(panel_width, n)]);
+	for (std::uint64_t j = 0; j < n; j += panel_width) {
+		const auto cols = std::min<std::size_t>(panel_width, n - j);
+		gather_panel(
+			buffer.get(), m,
+			op == op_t::no_transpose ? ptr + j * ld : ptr + j, ld,
+			m, cols,
+			op,
+			convert
+			);
+		ofs.write(reinterpret_cast<const char*>(buffer.get()), m * cols * sizeof(MATFILE_T));
 	}
+}
 
-	while (std::getline(ifs, line)) {
-		if (line[0] != '%') {
-			break;
+// pread/pwrite may transfer fewer bytes than requested
+inline bool pread_all(
+		const int fd,
+		void* const ptr,
+		const std::size_t size,
+		const std::size_t offset
+		) {
+	std::size_t completed = 0;
+	while (completed < size) {
+		const auto s = pread(fd, reinterpret_cast<char*>(ptr) + completed, size - completed, offset + completed);
+		if (s <= 0) {
+			return false;
 		}
+		completed += s;
 	}
-	std::size_t m, n, num_elements;
-
-	std::stringstream ss(line);
-	ss >> m >> n >> num_elements;
+	return true;
+}
 
-	if (fill_zero) {
-		for (std::size_t i = 0; i < m; i++) {
-			for (std::size_t j = 0; j < n; j++) {
-				ptr[i + j * ld] = 0;
-			}
+inline bool pwrite_all(
+		const int fd,
+		const void* const ptr,
+		const std::size_t size,
+		const std::size_t offset
+		) {
+	std::size_t completed = 0;
+	while (completed < size) {
+		const auto s = pwrite(fd, reinterpret_cast<const char*>(ptr) + completed, size - completed, offset + completed);
+		if (s <= 0) {
+			return false;
 		}
+		completed += s;
 	}
+	return true;
+}
 
-	for (std::size_t l = 0; l < num_elements; l++) {
-		if (element_type == detail::real_value) {
-			std::size_t i, j;
-			double v;
-			ifs >> i >> j >> v;
-			i--;j--;
-
-			ptr[i + j * ld] = v;
+// CRC32C (Castagnoli). The software version is slice-by-8 and the SSE4.2 version is used when the CPU supports it.
+struct crc32c_table {
+	std::uint32_t t[8][256];
 
-			if (matrix_type == detail::symmetric_matrix) {
-				ptr[j + i * ld] = v;
+	constexpr crc32c_table() : t() {
+		for (std::uint32_t i = 0; i < 256; i++) {
+			std::uint32_t c = i;
+			for (unsigned k = 0; k < 8; k++) {
+				c = (c >> 1) ^ (0x82f63b78u & (0u - (c & 1u)));
 			}
-		} else if (element_type == detail::pattern_value) {
-			std::size_t i, j;
-			ifs >> i >> j;
-			i--;j--;
-
-			ptr[i + j * ld] = 1;
-
-			if (matrix_type == detail::symmetric_matrix) {
-				ptr[j + i * ld] = 1;
+			t[0][i] = c;
+		}
+		for (std::uint32_t i = 0; i < 256; i++) {
+			for (unsigned k = 1; k < 8; k++) {
+				t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
 			}
 		}
 	}
-	ifs.close();
+};
+
+inline std::uint32_t crc32c_update_sw(
+		std::uint32_t crc,
+		const void* const ptr,
+		std::size_t size
+		) {
+	static constexpr crc32c_table table;
+	const auto& t = table.t;
+	auto p = static_cast<const std::uint8_t*>(ptr);
+	crc = ~crc;
+	for (; size >= 8; size -= 8, p += 8) {
+		std::uint32_t lo, hi;
+		std::memcpy(&lo, p, 4);
+		std::memcpy(&hi, p + 4, 4);
+		lo ^= crc;
+		crc =
+			t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+			t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+	}
+	for (; size > 0; size--, p++) {
+		crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+	}
+	return ~crc;
+}
+
+#ifdef MATFILE_ENABLE_SSE42
+inline bool has_sse42() {
+	static const bool supported = __builtin_cpu_supports("sse4.2");
+	return supported;
+}
+
+// Appending crc32c_stream_size zero bytes is a linear map of the CRC register, tabulated byte by byte
+constexpr std::size_t crc32c_stream_size = 4096;
+
+struct crc32c_shift_table {
+	std::uint32_t t[4][256];
+};
+
+__attribute__((target("sse4.2")))
+inline crc32c_shift_table make_crc32c_shift_table() {
+	std::uint32_t basis[32];
+	for (unsigned b = 0; b < 32; b++) {
+		std::uint64_t c = std::uint64_t(1) << b;
+		for (std::size_t i = 0; i < crc32c_stream_size; i += 8) {
+			c = _mm_crc32_u64(c, 0);
+		}
+		basis[b] = static_cast<std::uint32_t>(c);
+	}
+	crc32c_shift_table table;
+	for (unsigned k = 0; k < 4; k++) {
+		for (unsigned v = 0; v < 256; v++) {
+			std::uint32_t r = 0;
+			for (unsigned b = 0; b < 8; b++) {
+				if ((v >> b) & 1u) {
+					r ^= basis[k * 8 + b];
+				}
+			}
+			table.t[k][v] = r;
+		}
+	}
+	return table;
+}
+
+inline std::uint32_t crc32c_shift(
+		const crc32c_shift_table& table,
+		const std::uint64_t crc
+		) {
+	return table.t[0][crc & 0xff] ^ table.t[1][(crc >> 8) & 0xff] ^ table.t[2][(crc >> 16) & 0xff] ^ table.t[3][(crc >> 24) & 0xff];
+}
+
+__attribute__((target("sse4.2")))
+inline std::uint32_t crc32c_update_sse42(
+		const std::uint32_t crc,
+		const void* const ptr,
+		std::size_t size
+		) {
+	static const auto shift_table = make_crc32c_shift_table();
+	auto p = static_cast<const std::uint8_t*>(ptr);
+	std::uint64_t c = ~crc;
+
+	// Three independent streams hide the latency of the crc32 instruction
+	constexpr auto s = crc32c_stream_size;
+	for (; size >= 3 * s; size -= 3 * s, p += 3 * s) {
+		std::uint64_t c1 = 0, c2 = 0;
+		for (std::size_t i = 0; i < s; i += 8) {
+			std::uint64_t v0, v1, v2;
+			std::memcpy(&v0, p + i, 8);
+			std::memcpy(&v1, p + i + s, 8);
+			std::memcpy(&v2, p + i + 2 * s, 8);
+			c  = _mm_crc32_u64(c , v0);
+			c1 = _mm_crc32_u64(c1, v1);
+			c2 = _mm_crc32_u64(c2, v2);
+		}
+		c = crc32c_shift(shift_table, crc32c_shift(shift_table, c) ^ c1) ^ c2;
+	}
+	for (; size >= 8; size -= 8, p += 8) {
+		std::uint64_t v;
+		std::memcpy(&v, p, 8);
+		c = _mm_crc32_u64(c, v);
+	}
+	auto c32 = static_cast<std::uint32_t>(c);
+	for (; size > 0; size--, p++) {
+		c32 = _mm_crc32_u8(c32, *p);
+	}
+	return ~c32;
+}
+#endif
+
+// CRC32C of `size` bytes following the bytes whose CRC32C is `crc` (0 for the first bytes)
+inline std::uint32_t crc32c_update(
+		const std::uint32_t crc,
+		const void* const ptr,
+		const std::size_t size
+		) {
+#ifdef MATFILE_ENABLE_SSE42
+	if (has_sse42()) {
+		return crc32c_update_sse42(crc, ptr, size);
+	}
+#endif
+	return crc32c_update_sw(crc, ptr, size);
+}
+
+// pread_all updating `*crc` (when not null) piece by piece while each piece is still in the cache
+inline bool pread_crc32c(
+		const int fd,
+		void* const ptr,
+		const std::size_t size,
+		const std::size_t offset,
+		std::uint32_t* const crc
+		) {
+	if (crc == nullptr) {
+		return pread_all(fd, ptr, size, offset);
+	}
+	constexpr std::size_t piece_size = 1lu << 17;
+	for (std::size_t done = 0; done < size; done += piece_size) {
+		const auto piece = std::min(piece_size, size - done);
+		if (!pread_all(fd, static_cast<char*>(ptr) + done, piece, offset + done)) {
+			return false;
+		}
+		*crc = crc32c_update(*crc, static_cast<char*>(ptr) + done, piece);
+	}
+	return true;
+}
+
+enum class read_status {
+	ok,
+	failed,
+	checksum_mismatch
+};
+
+inline void check_read_status(
+		const read_status status,
+		const std::string& mat_name
+		) {
+	if (status == read_status::checksum_mismatch) {
+		throw std::runtime_error("[matfile error] Checksum mismatch : " + mat_name);
+	}
+	if (status == read_status::failed) {
+		throw std::runtime_error("[matfile error] Failed to read : " + mat_name);
+	}
+}
+
+// Panel width used when the columns are distributed over `num_threads` threads
+template <class MATFILE_T>
+inline std::size_t get_parallel_panel_width(
+		const std::size_t m,
+		const std::size_t n,
+		const op_t op,
+		const unsigned num_threads
+		) {
+	return std::max<std::size_t>(1, std::min(get_panel_width<MATFILE_T>(m, op), (n + num_threads - 1) / num_threads));
+}
+
+// Load the window [row0, row0 + rows) x [col0, col0 + cols) of an m-row matrix stored in `fd`
+template <class T, class MATFILE_T>
+bool load_dense_block_core(
+		T* const ptr,
+		const int fd,
+		const std::size_t m,
+		const std::size_t row0,
+		const std::size_t col0,
+		const std::size_t rows,
+		const std::size_t cols,
+		const std::uint64_t ld,
+		const op_t op,
+		const convert_t convert,
+		const unsigned num_threads
+		) {
+	const auto panel_width = get_parallel_panel_width<MATFILE_T>(rows, cols, op, num_threads);
+	const std::int64_t num_panels = (cols + panel_width - 1) / panel_width;
+	bool succeeded = true;
+
+MATFILE_OMP(omp parallel num_threads(num_threads))
+	{
+		std::unique_ptr<MATFILE_T[]> buffer;
+MATFILE_OMP(omp for schedule(dynamic))
+		for (std::int64_t p = 0; p < num_panels; p++) {
+			const std::size_t j = p * panel_width;
+			const auto panel_cols = std::min<std::size_t>(panel_width, cols - j);
+			const auto offset = sizeof(file_header) + (row0 + (col0 + j) * m) * sizeof(MATFILE_T);
+
+			// Read the panel to `dst` with leading dimension `dst_ld`
+			const auto read_panel = [&](MATFILE_T* const dst, const std::size_t dst_ld) {
+				if (rows == m && dst_ld == m) {
+					return pread_all(fd, dst, m * panel_cols * sizeof(MATFILE_T), offset);
+				}
+				bool s = true;
+				for (std::size_t jj = 0; jj < panel_cols; jj++) {
+					s = s && pread_all(fd, dst + jj * dst_ld, rows * sizeof(MATFILE_T), offset + jj * m * sizeof(MATFILE_T));
+				}
+				return s;
+			};
+
+			bool s = true;
+			if constexpr (std::is_same<T, MATFILE_T>::value) {
+				if (op == op_t::no_transpose) {
+					s = read_panel(ptr + j * ld, ld);
+					if (!s) {
+MATFILE_OMP(omp atomic write)
+						succeeded = false;
+					}
+					continue;
+				}
+			}
+			if (!buffer) {
+				buffer.reset(new MATFILE_T[rows * panel_width]);
+			}
+			s = read_panel(buffer.get(), rows);
+			if (s) {
+				scatter_panel(
+					op == op_t::no_transpose ? ptr + j * ld : ptr + j, ld,
+					buffer.get(), rows,
+					rows, panel_cols,
+					op,
+					convert
+					);
+			} else {
+MATFILE_OMP(omp atomic write)
+				succeeded = false;
+			}
+		}
+	}
+	return succeeded;
+}
+
+template <class T, class MATFILE_T>
+bool save_dense_parallel_core(
+		const int fd,
+		const T* const ptr,
+		const std::size_t m,
+		const std::size_t n,
+		const std::uint64_t ld,
+		const op_t op,
+		const convert_t convert,
+		const unsigned num_threads,
+		const std::size_t chunk_cols,
+		std::uint32_t* const checksums
+		) {
+	// When `checksums` is given, the CRC32C of the panel p of `chunk_cols` columns is stored to checksums[p + 1]
+	const auto panel_width = chunk_cols != 0 ? chunk_cols : get_parallel_panel_width<MATFILE_T>(m, n, op, num_threads);
+	const std::int64_t num_panels = (n + panel_width - 1) / panel_width;
+	bool succeeded = true;
+
+MATFILE_OMP(omp parallel num_threads(num_threads))
+	{
+		std::unique_ptr<MATFILE_T[]> buffer;
+MATFILE_OMP(omp for schedule(dynamic))
+		for (std::int64_t p = 0; p < num_panels; p++) {
+			const std::size_t j = p * panel_width;
+			const auto cols = std::min<std::size_t>(panel_width, n - j);
+			const auto offset = sizeof(file_header) + j * m * sizeof(MATFILE_T);
+
+			bool s = true;
+			std::uint32_t crc = 0;
+			if (std::is_same<T, MATFILE_T>::value && op == op_t::no_transpose) {
+				if (ld == m) {
+					s = pwrite_all(fd, ptr + j * ld, m * cols * sizeof(T), offset);
+					if (checksums) {
+						crc = crc32c_update(crc, ptr + j * ld, m * cols * sizeof(T));
+					}
+				} else {
+					for (std::size_t jj = 0; jj < cols; jj++) {
+						s = s && pwrite_all(fd, ptr + (j + jj) * ld, m * sizeof(T), offset + jj * m * sizeof(T));
+						if (checksums) {
+							crc = crc32c_update(crc, ptr + (j + jj) * ld, m * sizeof(T));
+						}
+					}
+				}
+			} else {
+				if (!buffer) {
+					buffer.reset(new MATFILE_T[m * panel_width]);
+				}
+				gather_panel(
+					buffer.get(), m,
+					op == op_t::no_transpose ? ptr + j * ld : ptr + j, ld,
+					m, cols,
+					op,
+					convert
+					);
+				s = pwrite_all(fd, buffer.get(), m * cols * sizeof(MATFILE_T), offset);
+				if (checksums) {
+					crc = crc32c_update(crc, buffer.get(), m * cols * sizeof(MATFILE_T));
+				}
+			}
+			if (checksums) {
+				checksums[p + 1] = crc;
+			}
+			if (!s) {
+MATFILE_OMP(omp atomic write)
+				succeeded = false;
+			}
+		}
+	}
+	return succeeded;
+}
+
+// Alignment of offsets, sizes and buffers required by O_DIRECT
+constexpr std::size_t direct_io_alignment = 4096;
+
+inline std::size_t align_up(
+		const std::size_t size
+		) {
+	return (size + direct_io_alignment - 1) / direct_io_alignment * direct_io_alignment;
+}
+
+struct free_deleter {
+	void operator()(void* const ptr) const {
+		std::free(ptr);
+	}
+};
+using aligned_buffer_t = std::unique_ptr<char, free_deleter>;
+
+inline aligned_buffer_t make_aligned_buffer(
+		const std::size_t size
+		) {
+	void* ptr;
+	if (posix_memalign(&ptr, direct_io_alignment, align_up(size)) != 0) {
+		throw std::bad_alloc();
+	}
+	return aligned_buffer_t(reinterpret_cast<char*>(ptr));
+}
+
+// Open a file with O_DIRECT, falling back to buffered I/O when the file system does not support it
+inline int open_direct(
+		const std::string path,
+		const int flags
+		) {
+	const int fd = open(path.c_str(), flags | O_DIRECT, 0644);
+	if (fd < 0 && errno == EINVAL) {
+		return open(path.c_str(), flags, 0644);
+	}
+	return fd;
+}
+
+// Read an aligned range of which only the first `required_size` bytes have to exist in the file
+inline bool pread_direct(
+		const int fd,
+		char* const ptr,
+		const std::size_t size,
+		const std::size_t offset,
+		const std::size_t required_size
+		) {
+	std::size_t completed = 0;
+	while (completed < required_size) {
+		const auto s = pread(fd, ptr + completed, size - completed, offset + completed);
+		if (s <= 0) {
+			return false;
+		}
+		completed += s;
+	}
+	return true;
+}
+
+// Sequential writer gathering the data into aligned blocks for O_DIRECT
+class direct_stream {
+	const int fd;
+	const std::size_t capacity;
+	aligned_buffer_t buffer;
+	std::size_t filled;
+	std::size_t file_offset;
+
+	bool flush() {
+		const auto succeeded = pwrite_all(fd, buffer.get(), capacity, file_offset);
+		file_offset += capacity;
+		filled = 0;
+		return succeeded;
+	}
+public:
+	direct_stream(
+			const int fd
+			) : fd(fd), capacity(io_buffer_size), buffer(make_aligned_buffer(io_buffer_size)), filled(0), file_offset(0) {}
+
+	bool write(
+			const void* const ptr,
+			const std::size_t size
+			) {
+		std::size_t completed = 0;
+		while (completed < size) {
+			const auto s = std::min(size - completed, capacity - filled);
+			std::memcpy(buffer.get() + filled, reinterpret_cast<const char*>(ptr) + completed, s);
+			filled += s;
+			completed += s;
+			if (filled == capacity && !flush()) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Write the remaining data. The unaligned tail is written without O_DIRECT.
+	bool finish() {
+		const auto aligned_size = filled / direct_io_alignment * direct_io_alignment;
+		if (!pwrite_all(fd, buffer.get(), aligned_size, file_offset)) {
+			return false;
+		}
+		if (aligned_size == filled) {
+			return true;
+		}
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+		return pwrite_all(fd, buffer.get() + aligned_size, filled - aligned_size, file_offset + aligned_size);
+	}
+};
+
+template <class T, class MATFILE_T>
+bool load_dense_direct_core(
+		T* const ptr,
+		const int fd,
+		const std::size_t m,
+		const std::size_t n,
+		const std::uint64_t ld,
+		const op_t op,
+		const convert_t convert
+		) {
+	const auto panel_width = std::min<std::size_t>(get_panel_width<MATFILE_T>(m, op), std::max<std::size_t>(n, 1));
+	// A panel is not aligned in general, so one extra block is needed at each side
+	auto buffer = make_aligned_buffer(m * panel_width * sizeof(MATFILE_T) + 2 * direct_io_alignment);
+
+	for (std::uint64_t j = 0; j < n; j += panel_width) {
+		const auto cols = std::min<std::size_t>(panel_width, n - j);
+		const std::size_t begin = sizeof(file_header) + j * m * sizeof(MATFILE_T);
+		const std::size_t end = begin + cols * m * sizeof(MATFILE_T);
+		const auto aligned_begin = begin / direct_io_alignment * direct_io_alignment;
+
+		if (!pread_direct(fd, buffer.get(), align_up(end) - aligned_begin, aligned_begin, end - aligned_begin)) {
+			return false;
+		}
+		scatter_panel(
+			op == op_t::no_transpose ? ptr + j * ld : ptr + j, ld,
+			reinterpret_cast<const MATFILE_T*>(buffer.get() + (begin - aligned_begin)), m,
+			m, cols,
+			op,
+			convert
+			);
+	}
+	return true;
+}
+
+template <class T, class MATFILE_T>
+bool save_dense_direct_core(
+		const int fd,
+		const file_header& header,
+		const T* const ptr,
+		const std::size_t m,
+		const std::size_t n,
+		const std::uint64_t ld,
+		const op_t op,
+		const convert_t convert
+		) {
+	direct_stream stream(fd);
+	if (!stream.write(&header, sizeof(header))) {
+		return false;
+	}
+
+	if (std::is_same<T, MATFILE_T>::value && op == op_t::no_transpose) {
+		for (std::uint64_t j = 0; j < n; j++) {
+			if (!stream.write(ptr + j * ld, m * sizeof(T))) {
+				return false;
+			}
+		}
+	} else {
+		const auto panel_width = get_panel_width<MATFILE_T>(m, op);
+		std::unique_ptr<MATFILE_T[]> buffer(new MATFILE_T[m * std::min<std::size_t>(panel_width, n)]);
+		for (std::uint64_t j = 0; j < n; j += panel_width) {
+			const auto cols = std::min<std::size_t>(panel_width, n - j);
+			gather_panel(
+				buffer.get(), m,
+				op == op_t::no_transpose ? ptr + j * ld : ptr + j, ld,
+				m, cols,
+				op,
+				convert
+				);
+			if (!stream.write(buffer.get(), m * cols * sizeof(MATFILE_T))) {
+				return false;
+			}
+		}
+	}
+	return stream.finish();
+}
+
+// ---- Encoded (compressed) payload ----
+// An encoded payload consists of the offset table of the chunks (num_chunks + 1 file offsets) followed by the chunks.
+// Each chunk holds a1 columns and is decoded independently.
+// A chunk whose stored size equals its raw size is stored without compression.
+// a0 : bits 0-7 codec_t, bits 8-15 filter_t, bits 16-23 quantize_t
+// a2 : the number of rows per quantization block (0 : whole column)
+inline bool is_encoded(
+		const file_header& header
+		) {
+#ifndef MATFILE_USE_OLD_FORMAT
+	return get_major_version(header.version) == 0 && get_minor_version(header.version) >= 8 && header.a0 != 0;
+#else
+	(void)header;
+	return false;
+#endif
+}
+
+inline codec_t get_codec(
+		const file_header& header
+		) {
+	return static_cast<codec_t>(header.a0 & 0xff);
+}
+
+inline filter_t get_filter(
+		const file_header& header
+		) {
+	return static_cast<filter_t>((header.a0 >> 8) & 0xff);
+}
+
+inline quantize_t get_quantize(
+		const file_header& header
+		) {
+	return static_cast<quantize_t>((header.a0 >> 16) & 0xff);
+}
+
+inline std::size_t get_quantize_block(
+		const file_header& header
+		) {
+	return std::max<std::size_t>(1, header.a2 == 0 ? header.m : std::min<std::uint64_t>(header.a2, header.m));
+}
+
+inline std::size_t get_num_chunks(
+		const file_header& header
+		) {
+	return header.a1 == 0 ? 0 : (header.n + header.a1 - 1) / header.a1;
+}
+
+// A file with checksums stores checksum_t in a3 bits 0-7 and the CRC32C values in a trailer after the last chunk :
+// the CRC of the bytes before the first chunk (the header and the offset table) followed by the CRC of each stored chunk.
+// A raw file with checksums is a version 0.8 file with a0 = 0 whose payload is split into chunks of a1 columns
+// for this purpose and is otherwise unchanged.
+inline checksum_t get_checksum(
+		const file_header& header
+		) {
+#ifndef MATFILE_USE_OLD_FORMAT
+	// a3 is not initialized in version 0.7 files
+	if (get_major_version(header.version) == 0 && get_minor_version(header.version) >= 8) {
+		return static_cast<checksum_t>(header.a3 & 0xff);
+	}
+#endif
+	(void)header;
+	return checksum_t::none;
+}
+
+// Whether the payload is read chunk by chunk
+inline bool is_chunked(
+		const file_header& header
+		) {
+	return is_encoded(header) || get_checksum(header) != checksum_t::none;
+}
+
+// Load the file offsets of the chunks (num_chunks + 1 entries, the last one is the end of the payload)
+// and the checksums of a chunked file. The checksum of the header and the offset table is verified here.
+inline read_status load_chunk_table(
+		const int fd,
+		const file_header& header,
+		std::vector<std::uint64_t>& offsets,
+		std::vector<std::uint32_t>& checksums
+		) {
+	const auto num_chunks = get_num_chunks(header);
+	const auto checksum = get_checksum(header);
+	if (header.a1 == 0 || (checksum != checksum_t::none && checksum != checksum_t::crc32c)) {
+		return read_status::failed;
+	}
+
+	// The header is read again so that the checksum is computed from the bytes in the file
+	offsets.resize(num_chunks + 1);
+	std::vector<char> head(sizeof(file_header) + (is_encoded(header) ? offsets.size() * sizeof(std::uint64_t) : 0));
+	if (!pread_all(fd, head.data(), head.size(), 0)) {
+		return read_status::failed;
+	}
+	if (is_encoded(header)) {
+		std::memcpy(offsets.data(), head.data() + sizeof(file_header), offsets.size() * sizeof(std::uint64_t));
+	} else {
+		const auto column_size = header.m * get_dtype_size(header.data_type);
+		for (std::size_t c = 0; c <= num_chunks; c++) {
+			offsets[c] = sizeof(file_header) + std::min<std::uint64_t>(c * header.a1, header.n) * column_size;
+		}
+	}
+
+	checksums.clear();
+	if (checksum == checksum_t::none) {
+		return read_status::ok;
+	}
+	checksums.resize(num_chunks + 1);
+	if (!pread_all(fd, checksums.data(), checksums.size() * sizeof(std::uint32_t), offsets[num_chunks])) {
+		return read_status::failed;
+	}
+	return crc32c_update(0, head.data(), head.size()) == checksums[0] ? read_status::ok : read_status::checksum_mismatch;
+}
+
+template <class MATFILE_T>
+inline std::uint64_t get_default_chunk_cols(
+		const std::size_t m
+		) {
+	// Chunks of a few MiB keep the compression ratio while allowing partial and parallel decoding
+	return std::max<std::size_t>(1, (1lu << 22) / (std::max<std::size_t>(1, m) * sizeof(MATFILE_T)));
+}
+
+// Built-in LZ77 codec used when no external compression library is available.
+// A sequence is a token (literal length << 4 | (match length - 4)), the extended literal length,
+// the literals, a 2-byte little endian match offset and the extended match length.
+// The last sequence has literals only.
+inline void builtin_compress(
+		const char* const src,
+		const std::size_t size,
+		std::vector<char>& dst
+		) {
+	constexpr std::size_t min_match = 4;
+	constexpr std::size_t max_offset = 65535;
+	constexpr unsigned hash_bits = 16;
+	constexpr std::uint32_t empty = ~0u;
+
+	const auto write_length = [&](std::size_t length) {
+		for (; length >= 255; length -= 255) {
+			dst.push_back(static_cast<char>(255));
+		}
+		dst.push_back(static_cast<char>(length));
+	};
+	const auto write_sequence = [&](const std::size_t literal_begin, const std::size_t literal_end, const std::size_t offset, const std::size_t match_length) {
+		const auto literal_length = literal_end - literal_begin;
+		const auto match_code = match_length == 0 ? 0 : match_length - min_match;
+		dst.push_back(static_cast<char>((std::min<std::size_t>(literal_length, 15) << 4) | std::min<std::size_t>(match_code, 15)));
+		if (literal_length >= 15) {
+			write_length(literal_length - 15);
+		}
+		dst.insert(dst.end(), src + literal_begin, src + literal_end);
+		if (match_length == 0) {
+			return;
+		}
+		dst.push_back(static_cast<char>(offset & 0xff));
+		dst.push_back(static_cast<char>(offset >> 8));
+		if (match_code >= 15) {
+			write_length(match_code - 15);
+		}
+	};
+	const auto read32 = [&](const std::size_t pos) {
+		std::uint32_t v;
+		std::memcpy(&v, src + pos, sizeof(v));
+		return v;
+	};
+
+	dst.clear();
+	std::vector<std::uint32_t> table(1u << hash_bits, empty);
+	std::size_t anchor = 0;
+	std::size_t pos = 0;
+	// The last bytes are always stored as literals
+	const std::size_t match_limit = size > 12 ? size - 12 : 0;
+	while (pos < match_limit) {
+		const auto seq = read32(pos);
+		const auto hash = (seq * 2654435761u) >> (32 - hash_bits);
+		const auto ref = table[hash];
+		table[hash] = pos;
+		if (ref == empty || pos - ref > max_offset || read32(ref) != seq) {
+			pos++;
+			continue;
+		}
+		std::size_t match_end = pos + min_match;
+		while (match_end < size - 5 && src[match_end] == src[ref + (match_end - pos)]) {
+			match_end++;
+		}
+		write_sequence(anchor, pos, pos - ref, match_end - pos);
+		pos = match_end;
+		anchor = pos;
+	}
+	write_sequence(anchor, size, 0, 0);
+}
+
+inline bool builtin_decompress(
+		const char* const src,
+		const std::size_t src_size,
+		char* const dst,
+		const std::size_t dst_size
+		) {
+	std::size_t ip = 0;
+	std::size_t op = 0;
+	const auto read_length = [&](std::size_t& length) {
+		for (;;) {
+			if (ip >= src_size) {
+				return false;
+			}
+			const auto v = static_cast<std::uint8_t>(src[ip++]);
+			length += v;
+			if (v != 255) {
+				return true;
+			}
+		}
+	};
+	while (ip < src_size) {
+		const auto token = static_cast<std::uint8_t>(src[ip++]);
+		std::size_t literal_length = token >> 4;
+		if (literal_length == 15 && !read_length(literal_length)) {
+			return false;
+		}
+		if (literal_length > src_size - ip || literal_length > dst_size - op) {
+			return false;
+		}
+		std::memcpy(dst + op, src + ip, literal_length);
+		ip += literal_length;
+		op += literal_length;
+		if (ip == src_size) {
+			break;
+		}
+
+		if (src_size - ip < 2) {
+			return false;
+		}
+		const std::size_t offset = static_cast<std::uint8_t>(src[ip]) | (static_cast<std::size_t>(static_cast<std::uint8_t>(src[ip + 1])) << 8);
+		ip += 2;
+		std::size_t match_length = token & 0xf;
+		if (match_length == 15 && !read_length(match_length)) {
+			return false;
+		}
+		match_length += 4;
+		if (offset == 0 || offset > op || match_length > dst_size - op) {
+			return false;
+		}
+		// The source and destination may overlap
+		for (std::size_t i = 0; i < match_length; i++) {
+			dst[op + i] = dst[op - offset + i];
+		}
+		op += match_length;
+	}
+	return op == dst_size;
+}
+
+#ifdef MATFILE_ENABLE_AVX2
+inline bool has_avx2() {
+	static const bool supported = __builtin_cpu_supports("avx2");
+	return supported;
+}
+
+template <std::size_t W>
+__attribute__((target("avx2")))
+inline __m256i unpacklo_avx2(const __m256i a, const __m256i b) {
+	if constexpr (W == 1) {return _mm256_unpacklo_epi8 (a, b);}
+	else if constexpr (W == 2) {return _mm256_unpacklo_epi16(a, b);}
+	else if constexpr (W == 4) {return _mm256_unpacklo_epi32(a, b);}
+	else {return _mm256_unpacklo_epi64(a, b);}
+}
+
+template <std::size_t W>
+__attribute__((target("avx2")))
+inline __m256i unpackhi_avx2(const __m256i a, const __m256i b) {
+	if constexpr (W == 1) {return _mm256_unpackhi_epi8 (a, b);}
+	else if constexpr (W == 2) {return _mm256_unpackhi_epi16(a, b);}
+	else if constexpr (W == 4) {return _mm256_unpackhi_epi32(a, b);}
+	else {return _mm256_unpackhi_epi64(a, b);}
+}
+
+constexpr std::size_t bit_reverse(
+		std::size_t k,
+		const std::size_t S
+		) {
+	std::size_t r = 0;
+	for (std::size_t s = 1; s < S; s *= 2) {
+		r = (r << 1) | (k & 1);
+		k >>= 1;
+	}
+	return r;
+}
+
+// Transpose the S x S matrix of (16 / S)-byte units in each 128-bit lane of r[0..S).
+// Afterwards r[k] holds the column bit_reverse(k, S).
+template <std::size_t S, std::size_t W = 16 / S>
+__attribute__((target("avx2")))
+inline void transpose_lanes_avx2(__m256i (&r)[S]) {
+	if constexpr (W < 16) {
+		__m256i t[S];
+		for (std::size_t k = 0; k < S / 2; k++) {
+			t[k        ] = unpacklo_avx2<W>(r[2 * k], r[2 * k + 1]);
+			t[k + S / 2] = unpackhi_avx2<W>(r[2 * k], r[2 * k + 1]);
+		}
+		for (std::size_t k = 0; k < S; k++) {
+			r[k] = t[k];
+		}
+		transpose_lanes_avx2<S, 2 * W>(r);
+	}
+}
+
+// pshufb mask gathering the bytes of each plane in a 16-byte row of 16 / S elements (or scattering them back)
+template <std::size_t S>
+__attribute__((target("avx2")))
+inline __m256i get_plane_mask_avx2(const bool inverse) {
+	alignas(32) std::uint8_t mask[32];
+	for (std::size_t k = 0; k < 16; k++) {
+		const auto g = (k % (16 / S)) * S + k / (16 / S);
+		if (inverse) {
+			mask[g] = mask[g + 16] = k;
+		} else {
+			mask[k] = mask[k + 16] = g;
+		}
+	}
+	return _mm256_load_si256(reinterpret_cast<const __m256i*>(mask));
+}
+
+// Load the 16-byte rows at p and p + offset into the low and high lanes
+__attribute__((target("avx2")))
+inline __m256i load_rows_avx2(const char* const p, const std::size_t offset) {
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + offset)), 1);
+}
+
+// Filter blocks of 32 elements of a column. Each block is loaded as 2S rows of 16 bytes, the low lanes holding
+// the first 16 elements and the high lanes the next 16, so that the in-lane transpose yields 32 contiguous bytes per plane.
+// The return value is the first element which is not filtered. With xor_delta, the element 0 is left to the caller too.
+template <std::size_t S>
+__attribute__((target("avx2")))
+inline std::size_t apply_filter_avx2(
+		char* const plane_col,
+		const std::size_t plane_stride,
+		const char* const col,
+		const std::size_t m,
+		const bool xor_delta
+		) {
+	const auto mask = get_plane_mask_avx2<S>(false);
+	std::size_t i = xor_delta ? 1 : 0;
+	for (; i + 32 <= m; i += 32) {
+		__m256i r[S];
+		for (std::size_t k = 0; k < S; k++) {
+			const char* const p = col + i * S + k * 16;
+			auto v = load_rows_avx2(p, 16 * S);
+			if (xor_delta) {
+				v = _mm256_xor_si256(v, load_rows_avx2(p - S, 16 * S));
+			}
+			r[k] = _mm256_shuffle_epi8(v, mask);
+		}
+		transpose_lanes_avx2<S>(r);
+		for (std::size_t k = 0; k < S; k++) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(plane_col + bit_reverse(k, S) * plane_stride + i), r[k]);
+		}
+	}
+	return i;
+}
+
+// Inverse of apply_filter_avx2. The XOR delta is undone by a prefix XOR over the elements of each row.
+template <std::size_t S>
+__attribute__((target("avx2")))
+inline std::size_t invert_filter_avx2(
+		char* const col,
+		const char* const plane_col,
+		const std::size_t plane_stride,
+		const std::size_t m,
+		const bool xor_delta
+		) {
+	const auto mask = get_plane_mask_avx2<S>(true);
+	// Broadcast of the last element of a row
+	alignas(16) std::uint8_t last[16];
+	for (std::size_t k = 0; k < 16; k++) {
+		last[k] = 16 - S + k % S;
+	}
+	const auto last_mask = _mm_load_si128(reinterpret_cast<const __m128i*>(last));
+
+	auto carry = _mm_setzero_si128();
+	std::size_t i = 0;
+	for (; i + 32 <= m; i += 32) {
+		__m256i r[S];
+		for (std::size_t k = 0; k < S; k++) {
+			r[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plane_col + k * plane_stride + i));
+		}
+		transpose_lanes_avx2<S>(r);
+		__m128i rows[2 * S];
+		for (std::size_t k = 0; k < S; k++) {
+			const auto v = _mm256_shuffle_epi8(r[k], mask);
+			rows[bit_reverse(k, S)    ] = _mm256_castsi256_si128(v);
+			rows[bit_reverse(k, S) + S] = _mm256_extracti128_si256(v, 1);
+		}
+		for (std::size_t q = 0; q < 2 * S; q++) {
+			auto v = rows[q];
+			if (xor_delta) {
+				if constexpr (S     < 16) {v = _mm_xor_si128(v, _mm_slli_si128(v, S    ));}
+				if constexpr (S * 2 < 16) {v = _mm_xor_si128(v, _mm_slli_si128(v, S * 2));}
+				if constexpr (S * 4 < 16) {v = _mm_xor_si128(v, _mm_slli_si128(v, S * 4));}
+				if constexpr (S * 8 < 16) {v = _mm_xor_si128(v, _mm_slli_si128(v, S * 8));}
+				v = _mm_xor_si128(v, carry);
+				carry = _mm_shuffle_epi8(v, last_mask);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(col + i * S + q * 16), v);
+		}
+	}
+	return i;
+}
+#endif
+
+// Filter a chunk of `cols` columns of m elements of S bytes.
+// The byte plane b of the column j is written to dst + b * m * cols + j * m.
+template <std::size_t S>
+inline void apply_filter_core(
+		char* const dst,
+		const char* const src,
+		const std::size_t m,
+		const std::size_t cols,
+		const bool xor_delta
+		) {
+	const auto num_elements = m * cols;
+	for (std::size_t j = 0; j < cols; j++) {
+		const char* const col = src + j * m * S;
+		char* const plane_col = dst + j * m;
+		const auto filter_range = [&](const std::size_t i_begin, const std::size_t i_end) {
+			for (std::size_t b = 0; b < S; b++) {
+				for (std::size_t i = i_begin; i < i_end; i++) {
+					plane_col[b * num_elements + i] = (xor_delta && i > 0) ? col[i * S + b] ^ col[(i - 1) * S + b] : col[i * S + b];
+				}
+			}
+		};
+
+		// [i0, i1) is filtered by the SIMD kernel
+		std::size_t i0 = 0, i1 = 0;
+#ifdef MATFILE_ENABLE_AVX2
+		if (has_avx2()) {
+			i0 = xor_delta ? std::min<std::size_t>(1, m) : 0;
+			i1 = std::max(i0, apply_filter_avx2<S>(plane_col, num_elements, col, m, xor_delta));
+		}
+#endif
+		filter_range(0, i0);
+		filter_range(i1, m);
+	}
+}
+
+template <std::size_t S>
+inline void invert_filter_core(
+		char* const dst,
+		const char* const src,
+		const std::size_t m,
+		const std::size_t cols,
+		const bool xor_delta
+		) {
+	const auto num_elements = m * cols;
+	for (std::size_t j = 0; j < cols; j++) {
+		char* const col = dst + j * m * S;
+		const char* const plane_col = src + j * m;
+
+		std::size_t i1 = 0;
+#ifdef MATFILE_ENABLE_AVX2
+		if (has_avx2()) {
+			i1 = invert_filter_avx2<S>(col, plane_col, num_elements, m, xor_delta);
+		}
+#endif
+		for (std::size_t i = i1; i < m; i++) {
+			for (std::size_t b = 0; b < S; b++) {
+				auto v = plane_col[b * num_elements + i];
+				if (xor_delta && i > 0) {
+					v ^= col[(i - 1) * S + b];
+				}
+				col[i * S + b] = v;
+			}
+		}
+	}
+}
+
+inline void apply_filter(
+		const filter_t filter,
+		const std::size_t element_size,
+		char* const dst,
+		const char* const src,
+		const std::size_t m,
+		const std::size_t cols,
+		const bool inverse
+		) {
+	const auto xor_delta = filter == filter_t::xor_shuffle;
+	switch (element_size) {
+#define MATFILE_FILTER_CODE(S) \
+	case S: \
+		if (inverse) { \
+			invert_filter_core<S>(dst, src, m, cols, xor_delta); \
+		} else { \
+			apply_filter_core<S>(dst, src, m, cols, xor_delta); \
+		} \
+		break
+		MATFILE_FILTER_CODE(1);
+		MATFILE_FILTER_CODE(2);
+		MATFILE_FILTER_CODE(4);
+		MATFILE_FILTER_CODE(8);
+		MATFILE_FILTER_CODE(16);
+#undef MATFILE_FILTER_CODE
+	default:
+		throw std::runtime_error("[matfile error] Unsupported element size for filtering : " + std::to_string(element_size));
+	}
+}
+
+inline bool is_codec_supported(const codec_t codec) {
+	switch (codec) {
+	case codec_t::none:
+	case codec_t::builtin:
+#ifdef MATFILE_USE_LZ4
+	case codec_t::lz4:
+#endif
+#ifdef MATFILE_USE_ZSTD
+	case codec_t::zstd:
+#endif
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Compress `size` bytes into `dst`.
+// When the data is not compressible, it is copied to `dst` as is.
+inline void compress_chunk(
+		const codec_t codec,
+		const char* const src,
+		const std::size_t size,
+		std::vector<char>& dst
+		) {
+	switch (codec) {
+	case codec_t::none:
+		break;
+	case codec_t::builtin:
+		builtin_compress(src, size, dst);
+		break;
+#ifdef MATFILE_USE_LZ4
+	case codec_t::lz4:
+		{
+			dst.resize(LZ4_compressBound(size));
+			const auto s = LZ4_compress_default(src, dst.data(), size, dst.size());
+			dst.resize(s > 0 ? s : size + 1);
+		}
+		break;
+#endif
+#ifdef MATFILE_USE_ZSTD
+	case codec_t::zstd:
+		{
+			dst.resize(ZSTD_compressBound(size));
+			const auto s = ZSTD_compress(dst.data(), dst.size(), src, size, 3);
+			dst.resize(ZSTD_isError(s) ? size + 1 : s);
+		}
+		break;
+#endif
+	default:
+		throw std::runtime_error("[matfile error] Unsupported codec : " + std::to_string(static_cast<unsigned>(codec)));
+	}
+	if (codec == codec_t::none || dst.size() >= size) {
+		dst.assign(src, src + size);
+	}
+}
+
+inline bool decompress_chunk(
+		const codec_t codec,
+		const char* const src,
+		const std::size_t src_size,
+		char* const dst,
+		const std::size_t dst_size
+		) {
+	if (src_size == dst_size) {
+		std::memcpy(dst, src, dst_size);
+		return true;
+	}
+	switch (codec) {
+	case codec_t::builtin:
+		return builtin_decompress(src, src_size, dst, dst_size);
+#ifdef MATFILE_USE_LZ4
+	case codec_t::lz4:
+		return LZ4_decompress_safe(src, dst, src_size, dst_size) == static_cast<int>(dst_size);
+#endif
+#ifdef MATFILE_USE_ZSTD
+	case codec_t::zstd:
+		return ZSTD_decompress(dst, dst_size, src, src_size) == dst_size;
+#endif
+	default:
+		break;
+	}
+	return false;
+}
+
+// ---- Quantized chunk ----
+// The (offset, scale) pairs of all blocks in MATFILE_T (column by column) followed by the unsigned codes in column-major order.
+// int4 codes are packed two per byte, the lower nibble first. An element is restored as offset + scale * code.
+// The values are assumed to be finite.
+template <class MATFILE_T>
+inline std::size_t get_quantized_chunk_size(
+		const std::size_t m,
+		const std::size_t cols,
+		const std::size_t block,
+		const quantize_t quantize
+		) {
+	const auto num_blocks = (m + block - 1) / block;
+	const auto num_codes = m * cols;
+	return cols * num_blocks * 2 * sizeof(MATFILE_T) + (quantize == quantize_t::int4 ? (num_codes + 1) / 2 : num_codes);
+}
+
+inline std::uint64_t splitmix64(
+		std::uint64_t& state
+		) {
+	auto z = (state += 0x9e3779b97f4a7c15lu);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9lu;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eblu;
+	return z ^ (z >> 31);
+}
+
+// `seed` makes the stochastic rounding deterministic for each chunk
+template <class MATFILE_T>
+inline void quantize_chunk(
+		char* const dst,
+		const MATFILE_T* const src,
+		const std::size_t m,
+		const std::size_t cols,
+		const std::size_t block,
+		const quantize_t quantize,
+		const bool stochastic,
+		std::uint64_t seed
+		) {
+	if constexpr (std::is_same<MATFILE_T, float>::value || std::is_same<MATFILE_T, double>::value) {
+		const auto num_blocks = (m + block - 1) / block;
+		const auto params = reinterpret_cast<MATFILE_T*>(dst);
+		const auto codes = reinterpret_cast<std::uint8_t*>(dst + cols * num_blocks * 2 * sizeof(MATFILE_T));
+		const MATFILE_T max_code = quantize == quantize_t::int4 ? 15 : 255;
+		if (quantize == quantize_t::int4) {
+			std::memset(codes, 0, (m * cols + 1) / 2);
+		}
+
+		for (std::size_t j = 0; j < cols; j++) {
+			for (std::size_t b = 0; b < num_blocks; b++) {
+				const auto i0 = b * block;
+				const auto i1 = std::min(i0 + block, m);
+				const auto v = src + j * m;
+				auto min = v[i0], max = v[i0];
+				for (std::size_t i = i0; i < i1; i++) {
+					min = std::min(min, v[i]);
+					max = std::max(max, v[i]);
+				}
+				const MATFILE_T scale = (max - min) / max_code;
+				const MATFILE_T inv_scale = max > min ? max_code / (max - min) : 0;
+				params[2 * (b + j * num_blocks) + 0] = min;
+				params[2 * (b + j * num_blocks) + 1] = scale;
+
+				for (std::size_t i = i0; i < i1; i++) {
+					const auto x = (v[i] - min) * inv_scale;
+					const auto r = stochastic ? std::floor(x + static_cast<MATFILE_T>((splitmix64(seed) >> 11) * 0x1p-53)) : std::nearbyint(x);
+					const auto code = static_cast<std::uint8_t>(std::min(std::max(r, MATFILE_T(0)), max_code));
+					const auto k = i + j * m;
+					if (quantize == quantize_t::int4) {
+						codes[k >> 1] |= code << ((k & 1) * 4);
+					} else {
+						codes[k] = code;
+					}
+				}
+			}
+		}
+	}
+}
+
+template <class MATFILE_T>
+MATFILE_TARGET_CLONES MATFILE_NO_FP_CONTRACT
+void dequantize_int8_kernel(
+		MATFILE_T* __restrict__ const dst,
+		const std::uint8_t* __restrict__ const codes,
+		const std::size_t count,
+		const MATFILE_T offset,
+		const MATFILE_T scale
+		) {
+MATFILE_OMP(omp simd)
+	for (std::size_t i = 0; i < count; i++) {
+		dst[i] = offset + scale * static_cast<MATFILE_T>(codes[i]);
+	}
+}
+
+// The elements [k0, k0 + count) of the packed array
+template <class MATFILE_T>
+MATFILE_TARGET_CLONES MATFILE_NO_FP_CONTRACT
+void dequantize_int4_kernel(
+		MATFILE_T* __restrict__ dst,
+		const std::uint8_t* __restrict__ const codes,
+		std::size_t k0,
+		std::size_t count,
+		const MATFILE_T offset,
+		const MATFILE_T scale
+		) {
+	if (count != 0 && k0 % 2 == 1) {
+		*(dst++) = offset + scale * static_cast<MATFILE_T>(codes[(k0++) >> 1] >> 4);
+		count--;
+	}
+	// Two elements per byte
+	const auto bytes = codes + k0 / 2;
+MATFILE_OMP(omp simd)
+	for (std::size_t p = 0; p < count / 2; p++) {
+		dst[2 * p + 0] = offset + scale * static_cast<MATFILE_T>(bytes[p] & 0xf);
+		dst[2 * p + 1] = offset + scale * static_cast<MATFILE_T>(bytes[p] >> 4);
+	}
+	if (count % 2 == 1) {
+		dst[count - 1] = offset + scale * static_cast<MATFILE_T>(bytes[count / 2] & 0xf);
+	}
+}
+
+// Dequantize the window [row0, row0 + rows) x [col0, col0 + cols) of a chunk with `chunk_n` columns into `dst`
+template <class MATFILE_T>
+inline bool dequantize_chunk(
+		MATFILE_T* const dst,
+		const std::size_t dst_ld,
+		const char* const src,
+		const std::size_t m,
+		const std::size_t chunk_n,
+		const std::size_t block,
+		const quantize_t quantize,
+		const std::size_t row0,
+		const std::size_t rows,
+		const std::size_t col0,
+		const std::size_t cols
+		) {
+	if constexpr (std::is_same<MATFILE_T, float>::value || std::is_same<MATFILE_T, double>::value) {
+		if (quantize != quantize_t::int8 && quantize != quantize_t::int4) {
+			return false;
+		}
+		const auto num_blocks = (m + block - 1) / block;
+		const auto params = reinterpret_cast<const MATFILE_T*>(src);
+		const auto codes = reinterpret_cast<const std::uint8_t*>(src + chunk_n * num_blocks * 2 * sizeof(MATFILE_T));
+		for (std::size_t j = col0; j < col0 + cols; j++) {
+			for (std::size_t b = row0 / block; b * block < row0 + rows; b++) {
+				const auto i0 = std::max(b * block, row0);
+				const auto i1 = std::min((b + 1) * block, row0 + rows);
+				const auto offset = params[2 * (b + j * num_blocks) + 0];
+				const auto scale = params[2 * (b + j * num_blocks) + 1];
+				const auto d = dst + (i0 - row0) + (j - col0) * dst_ld;
+				if (quantize == quantize_t::int8) {
+					dequantize_int8_kernel(d, codes + i0 + j * m, i1 - i0, offset, scale);
+				} else {
+					dequantize_int4_kernel(d, codes, i0 + j * m, i1 - i0, offset, scale);
+				}
+			}
+		}
+		return true;
+	} else {
+		return false;
+	}
+}
+
+// Load the window of a chunked (encoded and/or checksummed) payload.
+// Each chunk is verified right after it is read, while it is still in the cache.
+template <class T, class MATFILE_T>
+read_status load_dense_chunked_core(
+		T* const ptr,
+		const int fd,
+		const file_header& header,
+		const std::size_t row0,
+		const std::size_t col0,
+		const std::size_t rows,
+		const std::size_t cols,
+		const std::uint64_t ld,
+		const op_t op,
+		const convert_t convert,
+		[[maybe_unused]] const unsigned num_threads
+		) {
+	const std::size_t m = header.m;
+	const std::size_t chunk_cols = header.a1;
+	const bool encoded = is_encoded(header);
+	const auto codec = encoded ? get_codec(header) : codec_t::none;
+	const auto filter = encoded ? get_filter(header) : filter_t::none;
+	const auto quantize = encoded ? get_quantize(header) : quantize_t::none;
+	const auto quantize_block = get_quantize_block(header);
+	if (cols == 0) {
+		return read_status::ok;
+	}
+	if (chunk_cols == 0 || (quantize != quantize_t::none && filter != filter_t::none)) {
+		return read_status::failed;
+	}
+
+	std::vector<std::uint64_t> offsets;
+	std::vector<std::uint32_t> checksums;
+	const auto table_status = load_chunk_table(fd, header, offsets, checksums);
+	if (table_status != read_status::ok) {
+		return table_status;
+	}
+	const bool verify = !checksums.empty();
+
+	// Only the chunks overlapping with the requested columns are read
+	const std::int64_t chunk_begin = col0 / chunk_cols;
+	const std::int64_t chunk_end = (col0 + cols + chunk_cols - 1) / chunk_cols;
+	bool succeeded = true;
+	bool verified = true;
+
+MATFILE_OMP(omp parallel num_threads(num_threads))
+	{
+		std::vector<char> stored;
+		std::unique_ptr<MATFILE_T[]> raw;
+		std::unique_ptr<char[]> filtered(filter != filter_t::none ? new char[m * chunk_cols * sizeof(MATFILE_T)] : nullptr);
+		std::unique_ptr<char[]> quantized(quantize != quantize_t::none ? new char[get_quantized_chunk_size<MATFILE_T>(m, chunk_cols, quantize_block, quantize)] : nullptr);
+MATFILE_OMP(omp for schedule(dynamic))
+		for (std::int64_t c = chunk_begin; c < chunk_end; c++) {
+			const std::size_t chunk_j0 = c * chunk_cols;
+			const auto chunk_n = std::min<std::size_t>(chunk_cols, header.n - chunk_j0);
+			const auto raw_size = quantized ? get_quantized_chunk_size<MATFILE_T>(m, chunk_n, quantize_block, quantize) : m * chunk_n * sizeof(MATFILE_T);
+			const auto j_begin = std::max<std::size_t>(chunk_j0, col0);
+			const auto j_end = std::min<std::size_t>(chunk_j0 + chunk_n, col0 + cols);
+			auto dst = op == op_t::no_transpose ? ptr + (j_begin - col0) * ld : ptr + (j_begin - col0);
+
+			bool s = offsets[c] <= offsets[c + 1];
+			const bool compressed = s && offsets[c + 1] - offsets[c] != raw_size;
+			bool scattered = false;
+			std::uint32_t crc = 0;
+			std::uint32_t* const crc_ptr = verify ? &crc : nullptr;
+			if constexpr (std::is_same<T, MATFILE_T>::value) {
+				// A raw chunk inside the window is read directly into `ptr`
+				if (s && !encoded && op == op_t::no_transpose && rows == m && j_begin == chunk_j0 && j_end == chunk_j0 + chunk_n) {
+					// Column by column unless the columns are contiguous in `ptr`
+					const std::size_t step = ld == m ? chunk_n : 1;
+					for (std::size_t jj = 0; jj < chunk_n && s; jj += step) {
+						const auto size = step * m * sizeof(MATFILE_T);
+						s = pread_crc32c(fd, dst + jj * ld, size, offsets[c] + jj * m * sizeof(MATFILE_T), crc_ptr);
+					}
+					scattered = true;
+				}
+			}
+			if (!raw && !scattered) {
+				raw.reset(new MATFILE_T[m * chunk_cols]);
+			}
+			char* const decompressed = scattered ? nullptr : (quantized ? quantized.get() : (filtered ? filtered.get() : reinterpret_cast<char*>(raw.get())));
+			if (s && !scattered && compressed) {
+				stored.resize(offsets[c + 1] - offsets[c]);
+				s = pread_crc32c(fd, stored.data(), stored.size(), offsets[c], crc_ptr);
+			} else if (s && !scattered) {
+				// Stored without compression
+				s = pread_crc32c(fd, decompressed, raw_size, offsets[c], crc_ptr);
+			}
+			if (s && verify && crc != checksums[c + 1]) {
+MATFILE_OMP(omp atomic write)
+				verified = false;
+				continue;
+			}
+
+			if (s && compressed) {
+				s = decompress_chunk(codec, stored.data(), stored.size(), decompressed, raw_size);
+			}
+			if (s && filtered) {
+				apply_filter(filter, sizeof(MATFILE_T), reinterpret_cast<char*>(raw.get()), filtered.get(), m, chunk_n, true);
+			}
+			if (s && quantized) {
+				// Only the window is dequantized, directly into `ptr` when neither conversion nor transpose is needed
+				if constexpr (std::is_same<T, MATFILE_T>::value) {
+					if (op == op_t::no_transpose) {
+						s = dequantize_chunk(dst, ld, quantized.get(), m, chunk_n, quantize_block, quantize, row0, rows, j_begin - chunk_j0, j_end - j_begin);
+						scattered = true;
+					}
+				}
+				if (!scattered) {
+					s = dequantize_chunk(raw.get() + row0 + (j_begin - chunk_j0) * m, m, quantized.get(), m, chunk_n, quantize_block, quantize, row0, rows, j_begin - chunk_j0, j_end - j_begin);
+				}
+			}
+			if (!s) {
+MATFILE_OMP(omp atomic write)
+				succeeded = false;
+				continue;
+			}
+
+			if (!scattered) {
+				scatter_panel(
+					dst, ld,
+					raw.get() + row0 + (j_begin - chunk_j0) * m, m,
+					rows, j_end - j_begin,
+					op,
+					convert
+					);
+			}
+		}
+	}
+	if (!verified) {
+		return read_status::checksum_mismatch;
+	}
+	return succeeded ? read_status::ok : read_status::failed;
+}
+
+template <class T, class MATFILE_T>
+bool save_dense_encoded_core(
+		const int fd,
+		const file_header& header,
+		const T* const ptr,
+		const std::uint64_t ld,
+		const op_t op,
+		const convert_t convert,
+		const bool stochastic_rounding,
+		const unsigned num_threads
+		) {
+	const std::size_t m = header.m;
+	const std::size_t n = header.n;
+	const std::size_t chunk_cols = header.a1;
+	const auto codec = get_codec(header);
+	const auto filter = get_filter(header);
+	const auto quantize = get_quantize(header);
+	const auto quantize_block = get_quantize_block(header);
+	const std::int64_t num_chunks = get_num_chunks(header);
+
+	std::vector<std::uint64_t> offsets(num_chunks + 1);
+	offsets[0] = sizeof(file_header) + offsets.size() * sizeof(std::uint64_t);
+	std::vector<std::uint32_t> checksums(get_checksum(header) != checksum_t::none ? num_chunks + 1 : 0);
+
+	// The chunks are compressed in parallel batch by batch and written in order
+	std::vector<std::vector<char>> stored(num_threads);
+	std::vector<std::unique_ptr<MATFILE_T[]>> raw(num_threads);
+	std::vector<std::unique_ptr<char[]>> filtered(num_threads);
+	std::vector<std::unique_ptr<char[]>> quantized(num_threads);
+	bool succeeded = true;
+	bool encoded = true;
+	for (std::int64_t batch = 0; batch < num_chunks; batch += num_threads) {
+		const std::int64_t batch_end = std::min<std::int64_t>(batch + num_threads, num_chunks);
+MATFILE_OMP(omp parallel for num_threads(num_threads))
+		for (std::int64_t c = batch; c < batch_end; c++) {
+			// An exception cannot leave the parallel region, so it is turned into a write failure
+			try {
+				const auto k = c - batch;
+				const std::size_t chunk_j0 = c * chunk_cols;
+				const auto chunk_n = std::min<std::size_t>(chunk_cols, n - chunk_j0);
+				if (!raw[k]) {
+					raw[k].reset(new MATFILE_T[m * chunk_cols]);
+				}
+				gather_panel(
+					raw[k].get(), m,
+					op == op_t::no_transpose ? ptr + chunk_j0 * ld : ptr + chunk_j0, ld,
+					m, chunk_n,
+					op,
+					convert
+					);
+				const char* chunk = reinterpret_cast<const char*>(raw[k].get());
+				auto chunk_size = m * chunk_n * sizeof(MATFILE_T);
+				if (filter != filter_t::none) {
+					if (!filtered[k]) {
+						filtered[k].reset(new char[m * chunk_cols * sizeof(MATFILE_T)]);
+					}
+					apply_filter(filter, sizeof(MATFILE_T), filtered[k].get(), chunk, m, chunk_n, false);
+					chunk = filtered[k].get();
+				}
+				if (quantize != quantize_t::none) {
+					if (!quantized[k]) {
+						quantized[k].reset(new char[get_quantized_chunk_size<MATFILE_T>(m, chunk_cols, quantize_block, quantize)]);
+					}
+					quantize_chunk(quantized[k].get(), raw[k].get(), m, chunk_n, quantize_block, quantize, stochastic_rounding, c);
+					chunk = quantized[k].get();
+					chunk_size = get_quantized_chunk_size<MATFILE_T>(m, chunk_n, quantize_block, quantize);
+				}
+				compress_chunk(codec, chunk, chunk_size, stored[k]);
+				if (!checksums.empty()) {
+					checksums[c + 1] = crc32c_update(0, stored[k].data(), stored[k].size());
+				}
+			} catch (...) {
+MATFILE_OMP(omp atomic write)
+				encoded = false;
+			}
+		}
+		if (!encoded) {
+			return false;
+		}
+		for (std::int64_t c = batch; c < batch_end; c++) {
+			const auto& s = stored[c - batch];
+			succeeded = succeeded && pwrite_all(fd, s.data(), s.size(), offsets[c]);
+			offsets[c + 1] = offsets[c] + s.size();
+		}
+	}
+
+	if (!checksums.empty()) {
+		checksums[0] = crc32c_update(crc32c_update(0, &header, sizeof(header)), offsets.data(), offsets.size() * sizeof(std::uint64_t));
+		succeeded = succeeded && pwrite_all(fd, checksums.data(), checksums.size() * sizeof(std::uint32_t), offsets[num_chunks]);
+	}
+	return succeeded &&
+		pwrite_all(fd, &header, sizeof(header), 0) &&
+		pwrite_all(fd, offsets.data(), offsets.size() * sizeof(std::uint64_t), sizeof(header));
+}
+
+// Load the window [row0, row0 + rows) x [col0, col0 + cols) of a raw or chunked payload
+template <class T>
+read_status load_dense_window(
+		T* const ptr,
+		const int fd,
+		const file_header& header,
+		const std::size_t row0,
+		const std::size_t col0,
+		const std::size_t rows,
+		const std::size_t cols,
+		const std::uint64_t ld,
+		const op_t op,
+		const convert_t convert,
+		const unsigned num_threads
+		) {
+	auto status = read_status::ok;
+	dispatch_data_type(header.data_type, [&](const auto tag) {
+		using MATFILE_T = typename decltype(tag)::type;
+		if (is_chunked(header)) {
+			status = load_dense_chunked_core<T, MATFILE_T>(ptr, fd, header, row0, col0, rows, cols, ld, op, convert, num_threads);
+		} else if (!load_dense_block_core<T, MATFILE_T>(ptr, fd, header.m, row0, col0, rows, cols, ld, op, convert, num_threads)) {
+			status = read_status::failed;
+		}
+	});
+	return status;
+}
+} // namespace detail
+
+template <class T>
+void load_dense(
+		T* const mat_ptr,
+		const std::uint64_t ld,
+		const std::string mat_name,
+		const op_t op = op_t::no_transpose,
+		const io_options options = io_options{}
+		) {
+	const int fd = options.direct_io ? detail::open_direct(mat_name, O_RDONLY) : open(mat_name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("[matfile error] No such file : " + mat_name);
+	}
+
+	// The header is read with the alignment required by O_DIRECT
+	auto header_buffer = detail::make_aligned_buffer(detail::direct_io_alignment);
+	if (!detail::pread_direct(fd, header_buffer.get(), detail::direct_io_alignment, 0, sizeof(detail::file_header))) {
+		close(fd);
+		throw std::runtime_error("[matfile error] Failed to read : " + mat_name);
+	}
+	detail::file_header file_header;
+	std::memcpy(&file_header, header_buffer.get(), sizeof(file_header));
+	if (file_header.matrix_type != matrix_t::dense) {
+		close(fd);
+		throw std::runtime_error("[matfile error] Not a dense matrix : " + mat_name);
+	}
+
+	auto status = detail::read_status::ok;
+	if (options.direct_io && !detail::is_chunked(file_header)) {
+		detail::dispatch_data_type(file_header.data_type, [&](const auto tag) {
+			using MATFILE_T = typename decltype(tag)::type;
+			if (!detail::load_dense_direct_core<T, MATFILE_T>(mat_ptr, fd, file_header.m, file_header.n, ld, op, options.convert)) {
+				status = detail::read_status::failed;
+			}
+		});
+	} else {
+		// The chunk table and the chunks are read at unaligned offsets, which O_DIRECT rejects
+		if (options.direct_io && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT) != 0) {
+			close(fd);
+			throw std::runtime_error("[matfile error] Failed to read : " + mat_name);
+		}
+		status = detail::load_dense_window(mat_ptr, fd, file_header, 0, 0, file_header.m, file_header.n, ld, op, options.convert, std::max(1u, options.num_threads));
+	}
+	close(fd);
+	detail::check_read_status(status, mat_name);
+}
+
+// Load the submatrix [row0, row0 + rows) x [col0, col0 + cols) without reading the rest of the payload
+template <class T>
+void load_dense_block(
+		T* const mat_ptr,
+		const std::uint64_t ld,
+		const std::string mat_name,
+		const std::uint64_t row0,
+		const std::uint64_t col0,
+		const std::uint64_t rows,
+		const std::uint64_t cols,
+		const op_t op = op_t::no_transpose,
+		const io_options options = io_options{}
+		) {
+	const int fd = open(mat_name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("[matfile error] No such file : " + mat_name);
+	}
+
+	detail::file_header file_header;
+	if (!detail::pread_all(fd, &file_header, sizeof(file_header), 0)) {
+		close(fd);
+		throw std::runtime_error("[matfile error] Failed to read : " + mat_name);
+	}
+	if (file_header.matrix_type != matrix_t::dense) {
+		close(fd);
+		throw std::runtime_error("[matfile error] Not a dense matrix : " + mat_name);
+	}
+	if (row0 + rows > file_header.m || col0 + cols > file_header.n) {
+		close(fd);
+		throw std::runtime_error("[matfile error] The block (" + std::to_string(row0) + ":" + std::to_string(row0 + rows) + ", " + std::to_string(col0) + ":" + std::to_string(col0 + cols) + ") is out of range of " + mat_name);
+	}
+
+	const auto status = detail::load_dense_window(mat_ptr, fd, file_header, row0, col0, rows, cols, ld, op, options.convert, std::max(1u, options.num_threads));
+	close(fd);
+	detail::check_read_status(status, mat_name);
+}
+
+// Verify the checksums of a dense matfile saved with io_options::checksum without decoding it.
+// The return value is the indices of the corrupted chunks (of header.a1 columns each) and empty when the file is intact.
+inline std::vector<std::uint64_t> verify_dense(
+		const std::string mat_name,
+		[[maybe_unused]] const unsigned num_threads = 1
+		) {
+	const int fd = open(mat_name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("[matfile error] No such file : " + mat_name);
+	}
+
+	detail::file_header file_header;
+	if (!detail::pread_all(fd, &file_header, sizeof(file_header), 0)) {
+		close(fd);
+		throw std::runtime_error("[matfile error] Failed to read : " + mat_name);
+	}
+	if (file_header.matrix_type != matrix_t::dense) {
+		close(fd);
+		throw std::runtime_error("[matfile error] Not a dense matrix : " + mat_name);
+	}
+	if (detail::get_checksum(file_header) == checksum_t::none) {
+		close(fd);
+		throw std::runtime_error("[matfile error] No checksum is stored : " + mat_name);
+	}
+
+	std::vector<std::uint64_t> offsets;
+	std::vector<std::uint32_t> checksums;
+	const auto table_status = detail::load_chunk_table(fd, file_header, offsets, checksums);
+	if (table_status != detail::read_status::ok) {
+		close(fd);
+		detail::check_read_status(table_status, mat_name);
+	}
+
+	const std::int64_t num_chunks = offsets.size() - 1;
+	std::vector<std::uint8_t> corrupted(num_chunks, 0);
+	bool succeeded = true;
+MATFILE_OMP(omp parallel num_threads(std::max(1u, num_threads)))
+	{
+		std::vector<char> stored;
+MATFILE_OMP(omp for schedule(dynamic))
+		for (std::int64_t c = 0; c < num_chunks; c++) {
+			std::uint32_t crc = 0;
+			bool s = offsets[c] <= offsets[c + 1];
+			if (s) {
+				stored.resize(offsets[c + 1] - offsets[c]);
+				s = detail::pread_crc32c(fd, stored.data(), stored.size(), offsets[c], &crc);
+			}
+			if (!s) {
+MATFILE_OMP(omp atomic write)
+				succeeded = false;
+				continue;
+			}
+			corrupted[c] = crc != checksums[c + 1];
+		}
+	}
+	close(fd);
+	if (!succeeded) {
+		throw std::runtime_error("[matfile error] Failed to read : " + mat_name);
+	}
+
+	std::vector<std::uint64_t> corrupted_chunks;
+	for (std::int64_t c = 0; c < num_chunks; c++) {
+		if (corrupted[c]) {
+			corrupted_chunks.push_back(c);
+		}
+	}
+	return corrupted_chunks;
+}
+
+// Entry of a sidecar index of matfile headers, which allows listing and filtering a dataset without reading every file.
+// The index is a text file with a tab-separated line per matfile :
+// mtime, file size, matrix_t, data_t, m, n, checksum_t, path
+struct index_entry {
+	std::string path;
+	// Modification time (ns) and size of the file when the header was read
+	std::int64_t mtime;
+	std::uint64_t file_size;
+	matrix_t matrix_type;
+	data_t data_type;
+	std::uint64_t m;
+	std::uint64_t n;
+	checksum_t checksum;
+};
+
+namespace detail {
+inline bool stat_file(
+		const std::string& path,
+		std::int64_t& mtime,
+		std::uint64_t& file_size
+		) {
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0) {
+		return false;
+	}
+	mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+	file_size = st.st_size;
+	return true;
+}
+
+// Rejects files which are not matfiles, as far as the header can tell
+inline bool is_valid_header(
+		const file_header& header
+		) {
+	return static_cast<unsigned>(header.matrix_type) <= static_cast<unsigned>(matrix_t::csc) &&
+		static_cast<unsigned>(header.data_type) <= static_cast<unsigned>(data_t::bf16);
+}
+} // namespace detail
+
+inline std::vector<index_entry> load_index(
+		const std::string index_path
+		) {
+	std::ifstream ifs(index_path);
+	if (!ifs) {
+		throw std::runtime_error("[matfile error] No such file : " + index_path);
+	}
+
+	std::vector<index_entry> entries;
+	std::string line;
+	while (std::getline(ifs, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::istringstream iss(line);
+		index_entry entry;
+		unsigned matrix_type, data_type, checksum;
+		if (!(iss >> entry.mtime >> entry.file_size >> matrix_type >> data_type >> entry.m >> entry.n >> checksum) || iss.get() != '\t' || !std::getline(iss, entry.path)) {
+			throw std::runtime_error("[matfile error] Invalid index line \"" + line + "\" in " + index_path);
+		}
+		entry.matrix_type = static_cast<matrix_t>(matrix_type);
+		entry.data_type = static_cast<data_t>(data_type);
+		entry.checksum = static_cast<checksum_t>(checksum);
+		entries.push_back(std::move(entry));
+	}
+	return entries;
+}
+
+inline void save_index(
+		const std::vector<index_entry>& entries,
+		const std::string index_path
+		) {
+	// The index is replaced by renaming so that readers never see a partially written one
+	const auto tmp_path = index_path + ".tmp";
+	std::ofstream ofs(tmp_path);
+	if (!ofs) {
+		throw std::runtime_error("[matfile error] Failed to open : " + tmp_path);
+	}
+	ofs << "# mtime\tsize\tmatrix_t\tdata_t\tm\tn\tchecksum_t\tpath\n";
+	for (const auto& entry : entries) {
+		ofs << entry.mtime << '\t' << entry.file_size << '\t'
+			<< static_cast<unsigned>(entry.matrix_type) << '\t' << static_cast<unsigned>(entry.data_type) << '\t'
+			<< entry.m << '\t' << entry.n << '\t' << static_cast<unsigned>(entry.checksum) << '\t'
+			<< entry.path << '\n';
+	}
+	ofs.close();
+	if (!ofs || std::rename(tmp_path.c_str(), index_path.c_str()) != 0) {
+		std::remove(tmp_path.c_str());
+		throw std::runtime_error("[matfile error] Failed to write : " + index_path);
+	}
+}
+
+// Rewrite the index at `index_path` so that it describes `mat_names` and return its entries.
+// Only the headers of the files which are new or whose mtime or size changed are read, on `num_threads` threads.
+// Files which are missing or are not matfiles are left out.
+inline std::vector<index_entry> update_index(
+		const std::string index_path,
+		const std::vector<std::string>& mat_names,
+		[[maybe_unused]] const unsigned num_threads = 1
+		) {
+	std::unordered_map<std::string, index_entry> cached;
+	if (access(index_path.c_str(), F_OK) == 0) {
+		for (auto& entry : load_index(index_path)) {
+			auto path = entry.path;
+			cached.emplace(std::move(path), std::move(entry));
+		}
+	}
+
+	const std::int64_t num_files = mat_names.size();
+	std::vector<index_entry> entries(num_files);
+	std::vector<std::uint8_t> valid(num_files, 0);
+MATFILE_OMP(omp parallel for schedule(dynamic, 16) num_threads(std::max(1u, num_threads)))
+	for (std::int64_t i = 0; i < num_files; i++) {
+		auto& entry = entries[i];
+		entry.path = mat_names[i];
+		if (!detail::stat_file(entry.path, entry.mtime, entry.file_size)) {
+			continue;
+		}
+		const auto it = cached.find(entry.path);
+		if (it != cached.end() && it->second.mtime == entry.mtime && it->second.file_size == entry.file_size) {
+			entry = it->second;
+			valid[i] = 1;
+			continue;
+		}
+		detail::file_header header;
+		if (!detail::read_header(entry.path, header) || !detail::is_valid_header(header)) {
+			continue;
+		}
+		entry.matrix_type = header.matrix_type;
+		entry.data_type = header.data_type;
+		entry.m = header.m;
+		entry.n = header.n;
+		entry.checksum = header.matrix_type == matrix_t::dense ? detail::get_checksum(header) : checksum_t::none;
+		valid[i] = 1;
+	}
+
+	std::vector<index_entry> valid_entries;
+	for (std::int64_t i = 0; i < num_files; i++) {
+		if (valid[i]) {
+			valid_entries.push_back(std::move(entries[i]));
+		}
+	}
+	save_index(valid_entries, index_path);
+	return valid_entries;
+}
+
+template <class T, class MATFILE_T = T>
+void save_dense(
+		const std::uint64_t m,
+		const std::uint64_t n,
+		const T* const mat_ptr,
+		const std::uint64_t ld,
+		const std::string mat_name,
+		const op_t op = op_t::no_transpose,
+		const io_options options = io_options{}
+		) {
+	auto file_header = detail::make_dense_header<MATFILE_T>(m, n);
+
+	if (options.codec != codec_t::none || options.filter != filter_t::none || options.quantize != quantize_t::none) {
+#ifdef MATFILE_USE_OLD_FORMAT
+		throw std::runtime_error("[matfile error] Compression is not supported in the old format");
+#else
+		// The options are checked before the file is created
+		if (!detail::is_codec_supported(options.codec)) {
+			throw std::runtime_error("[matfile error] Unsupported codec : " + std::to_string(static_cast<unsigned>(options.codec)));
+		}
+		if (static_cast<unsigned>(options.filter) > static_cast<unsigned>(filter_t::xor_shuffle)) {
+			throw std::runtime_error("[matfile error] Unsupported filter : " + std::to_string(static_cast<unsigned>(options.filter)));
+		}
+		if (static_cast<unsigned>(options.quantize) > static_cast<unsigned>(quantize_t::int4)) {
+			throw std::runtime_error("[matfile error] Unsupported quantization : " + std::to_string(static_cast<unsigned>(options.quantize)));
+		}
+		if (options.quantize != quantize_t::none) {
+			if (!std::is_same<MATFILE_T, float>::value && !std::is_same<MATFILE_T, double>::value) {
+				throw std::runtime_error("[matfile error] Quantization is only supported for fp32 and fp64 : " + mat_name);
+			}
+			if (options.filter != filter_t::none) {
+				throw std::runtime_error("[matfile error] Quantization cannot be combined with a filter : " + mat_name);
+			}
+		}
+		file_header.version = detail::get_version_uint32(0, 8);
+		file_header.a0 = static_cast<std::uint64_t>(options.codec) | (static_cast<std::uint64_t>(options.filter) << 8) | (static_cast<std::uint64_t>(options.quantize) << 16);
+		file_header.a1 = options.chunk_cols != 0 ? options.chunk_cols : detail::get_default_chunk_cols<MATFILE_T>(m);
+		file_header.a2 = options.quantize != quantize_t::none ? options.quantize_block : 0;
+		file_header.a3 = static_cast<std::uint64_t>(options.checksum);
+
+		const int fd = open(mat_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			throw std::runtime_error("[matfile error] Failed to open : " + mat_name);
+		}
+
+		bool succeeded;
+		try {
+			succeeded = detail::save_dense_encoded_core<T, MATFILE_T>(fd, file_header, mat_ptr, ld, op, options.convert, options.stochastic_rounding, std::max(1u, options.num_threads));
+		} catch (...) {
+			close(fd);
+			throw;
+		}
+		close(fd);
+		if (!succeeded) {
+			throw std::runtime_error("[matfile error] Failed to write : " + mat_name);
+		}
+		return;
+#endif
+	}
+
+	if (options.checksum != checksum_t::none) {
+#ifdef MATFILE_USE_OLD_FORMAT
+		throw std::runtime_error("[matfile error] Checksums are not supported in the old format");
+#else
+		// The payload is written as is and the checksums of its chunks are appended
+		file_header.version = detail::get_version_uint32(0, 8);
+		file_header.a1 = options.chunk_cols != 0 ? options.chunk_cols : detail::get_default_chunk_cols<MATFILE_T>(m);
+		file_header.a3 = static_cast<std::uint64_t>(options.checksum);
+		std::vector<std::uint32_t> checksums(detail::get_num_chunks(file_header) + 1);
+		checksums[0] = detail::crc32c_update(0, &file_header, sizeof(file_header));
+
+		const int fd = open(mat_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			throw std::runtime_error("[matfile error] Failed to open : " + mat_name);
+		}
+
+		const auto succeeded =
+			detail::pwrite_all(fd, &file_header, sizeof(file_header), 0) &&
+			detail::save_dense_parallel_core<T, MATFILE_T>(fd, mat_ptr, m, n, ld, op, options.convert, std::max(1u, options.num_threads), file_header.a1, checksums.data()) &&
+			detail::pwrite_all(fd, checksums.data(), checksums.size() * sizeof(std::uint32_t), sizeof(file_header) + m * n * sizeof(MATFILE_T));
+		close(fd);
+		if (!succeeded) {
+			throw std::runtime_error("[matfile error] Failed to write : " + mat_name);
+		}
+		return;
+#endif
+	}
+
+	if (options.direct_io) {
+		const int fd = detail::open_direct(mat_name, O_WRONLY | O_CREAT | O_TRUNC);
+		if (fd < 0) {
+			throw std::runtime_error("[matfile error] Failed to open : " + mat_name);
+		}
+
+		const auto succeeded = detail::save_dense_direct_core<T, MATFILE_T>(fd, file_header, mat_ptr, m, n, ld, op, options.convert);
+		close(fd);
+		if (!succeeded) {
+			throw std::runtime_error("[matfile error] Failed to write : " + mat_name);
+		}
+		return;
+	}
+
+	if (options.num_threads > 1) {
+		const int fd = open(mat_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			throw std::runtime_error("[matfile error] Failed to open : " + mat_name);
+		}
+
+		const auto succeeded =
+			detail::pwrite_all(fd, &file_header, sizeof(file_header), 0) &&
+			detail::save_dense_parallel_core<T, MATFILE_T>(fd, mat_ptr, m, n, ld, op, options.convert, options.num_threads, 0, nullptr);
+		close(fd);
+		if (!succeeded) {
+			throw std::runtime_error("[matfile error] Failed to write : " + mat_name);
+		}
+		return;
+	}
+
+	std::ofstream ofs(mat_name, std::ios::binary);
+	ofs.write(reinterpret_cast<char*>(&file_header), sizeof(file_header));
+
+	detail::save_dense_core<T, MATFILE_T>(ofs, mat_ptr, m, n, ld, op, options.convert);
+	ofs.close();
+}
+
+namespace detail {
+// Worker pool executing asynchronous loads/saves
+class async_pool {
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex mtx;
+	std::condition_variable cv;
+	bool stop;
+public:
+	async_pool(const unsigned num_workers) : stop(false) {
+		for (unsigned i = 0; i < num_workers; i++) {
+			workers.emplace_back([this]() {
+				for (;;) {
+					std::function<void()> task;
+					{
+						std::unique_lock<std::mutex> lock(mtx);
+						cv.wait(lock, [this]() {return stop || !tasks.empty();});
+						if (tasks.empty()) {
+							return;
+						}
+						task = std::move(tasks.front());
+						tasks.pop();
+					}
+					task();
+				}
+			});
+		}
+	}
+
+	~async_pool() {
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			stop = true;
+		}
+		cv.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	template <class Func>
+	std::future<void> submit(Func func) {
+		auto task = std::make_shared<std::packaged_task<void()>>(func);
+		auto future = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			tasks.emplace([task]() {(*task)();});
+		}
+		cv.notify_one();
+		return future;
+	}
+};
+
+inline async_pool& get_async_pool() {
+	// The workers mostly wait for I/O, so more workers than cores are used
+	static async_pool pool(std::max(8u, std::thread::hardware_concurrency()));
+	return pool;
+}
+
+#ifdef MATFILE_USE_LIBURING
+// Transfer `size` bytes between `ptr` and the file at `offset` keeping multiple requests in flight
+inline bool uring_transfer(
+		const int fd,
+		char* const ptr,
+		const std::size_t size,
+		const std::size_t offset,
+		const bool write
+		) {
+	constexpr unsigned queue_depth = 32;
+	constexpr std::size_t block_size = 1lu << 20;
+
+	struct io_uring ring;
+	if (io_uring_queue_init(queue_depth, &ring, 0) < 0) {
+		return write ? pwrite_all(fd, ptr, size, offset) : pread_all(fd, ptr, size, offset);
+	}
+
+	struct request_t {
+		std::size_t pos;
+		std::size_t len;
+	};
+	request_t requests[queue_depth];
+	const auto submit = [&](request_t& request) {
+		auto sqe = io_uring_get_sqe(&ring);
+		if (write) {
+			io_uring_prep_write(sqe, fd, ptr + request.pos, request.len, offset + request.pos);
+		} else {
+			io_uring_prep_read(sqe, fd, ptr + request.pos, request.len, offset + request.pos);
+		}
+		io_uring_sqe_set_data(sqe, &request);
+	};
+
+	std::size_t next = 0;
+	unsigned num_in_flight = 0;
+	for (unsigned i = 0; i < queue_depth && next < size; i++) {
+		requests[i] = request_t{next, std::min(block_size, size - next)};
+		next += requests[i].len;
+		submit(requests[i]);
+		num_in_flight++;
+	}
+	io_uring_submit(&ring);
+
+	bool succeeded = true;
+	while (num_in_flight > 0) {
+		struct io_uring_cqe* cqe;
+		if (io_uring_wait_cqe(&ring, &cqe) < 0) {
+			succeeded = false;
+			break;
+		}
+		auto& request = *reinterpret_cast<request_t*>(io_uring_cqe_get_data(cqe));
+		const auto res = cqe->res;
+		io_uring_cqe_seen(&ring, cqe);
+		num_in_flight--;
+
+		if (res <= 0) {
+			// Wait for the remaining requests before releasing the ring
+			succeeded = false;
+			continue;
+		}
+		request.pos += res;
+		request.len -= res;
+		if (request.len == 0 && next < size) {
+			request = request_t{next, std::min(block_size, size - next)};
+			next += request.len;
+		}
+		if (request.len != 0 && succeeded) {
+			submit(request);
+			num_in_flight++;
+			io_uring_submit(&ring);
+		}
+	}
+	io_uring_queue_exit(&ring);
+
+	return succeeded;
+}
+
+// Load the payload with io_uring when it can be transferred to `ptr` as is.
+// The return value is false when this is not the case.
+template <class T>
+bool load_dense_uring(
+		T* const ptr,
+		const std::uint64_t ld,
+		const std::string mat_name,
+		const op_t op
+		) {
+	const int fd = open(mat_name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("[matfile error] No such file : " + mat_name);
+	}
+	file_header header;
+	if (!pread_all(fd, &header, sizeof(header), 0)) {
+		close(fd);
+		throw std::runtime_error("[matfile error] Failed to read : " + mat_name);
+	}
+	if (header.data_type != get_data_type<T>() || op != op_t::no_transpose || ld != header.m || is_chunked(header)) {
+		close(fd);
+		return false;
+	}
+	const auto succeeded = uring_transfer(fd, reinterpret_cast<char*>(ptr), header.m * header.n * sizeof(T), sizeof(header), false);
+	close(fd);
+	if (!succeeded) {
+		throw std::runtime_error("[matfile error] Failed to read : " + mat_name);
+	}
+	return true;
+}
+
+template <class T, class MATFILE_T>
+bool save_dense_uring(
+		const std::uint64_t m,
+		const std::uint64_t n,
+		const T* const ptr,
+		const std::uint64_t ld,
+		const std::string mat_name,
+		const op_t op
+		) {
+	if (!std::is_same<T, MATFILE_T>::value || op != op_t::no_transpose || ld != m) {
+		return false;
+	}
+	const int fd = open(mat_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		throw std::runtime_error("[matfile error] Failed to open : " + mat_name);
+	}
+	const auto header = make_dense_header<MATFILE_T>(m, n);
+	const auto succeeded =
+		pwrite_all(fd, &header, sizeof(header), 0) &&
+		uring_transfer(fd, reinterpret_cast<char*>(const_cast<T*>(ptr)), m * n * sizeof(T), sizeof(header), true);
+	close(fd);
+	if (!succeeded) {
+		throw std::runtime_error("[matfile error] Failed to write : " + mat_name);
+	}
+	return true;
+}
+#endif
+} // namespace detail
+
+// Asynchronous version of load_dense.
+// `mat_ptr` must stay valid until the returned future becomes ready.
+template <class T>
+std::future<void> load_dense_async(
+		T* const mat_ptr,
+		const std::uint64_t ld,
+		const std::string mat_name,
+		const op_t op = op_t::no_transpose,
+		const io_options options = io_options{}
+		) {
+	return detail::get_async_pool().submit([=]() {
+#ifdef MATFILE_USE_LIBURING
+		if (detail::load_dense_uring(mat_ptr, ld, mat_name, op)) {
+			return;
+		}
+#endif
+		load_dense(mat_ptr, ld, mat_name, op, options);
+	});
+}
+
+// Asynchronous version of save_dense.
+// `mat_ptr` must stay valid and unchanged until the returned future becomes ready.
+template <class T, class MATFILE_T = T>
+std::future<void> save_dense_async(
+		const std::uint64_t m,
+		const std::uint64_t n,
+		const T* const mat_ptr,
+		const std::uint64_t ld,
+		const std::string mat_name,
+		const op_t op = op_t::no_transpose,
+		const io_options options = io_options{}
+		) {
+	return detail::get_async_pool().submit([=]() {
+#ifdef MATFILE_USE_LIBURING
+		// io_uring writes a plain raw file, which is only what the default options ask for
+		const bool raw_file =
+			options.codec == codec_t::none &&
+			options.filter == filter_t::none &&
+			options.quantize == quantize_t::none &&
+			options.checksum == checksum_t::none &&
+			!options.direct_io;
+		if (raw_file && detail::save_dense_uring<T, MATFILE_T>(m, n, mat_ptr, ld, mat_name, op)) {
+			return;
+		}
+#endif
+		save_dense<T, MATFILE_T>(m, n, mat_ptr, ld, mat_name, op, options);
+	});
+}
+
+// Writer for saving a dense matrix column panel by column panel
+template <class T, class MATFILE_T = T>
+class dense_writer {
+	std::ofstream ofs;
+	const std::string mat_name;
+	const std::uint64_t m;
+	const std::uint64_t n;
+	std::uint64_t num_written_cols;
+public:
+	dense_writer(
+			const std::uint64_t m,
+			const std::uint64_t n,
+			const std::string mat_name
+			) : ofs(mat_name, std::ios::binary), mat_name(mat_name), m(m), n(n), num_written_cols(0) {
+		if (!ofs) {
+			throw std::runtime_error("[matfile error] Failed to open : " + mat_name);
+		}
+		auto file_header = detail::make_dense_header<MATFILE_T>(m, n);
+		ofs.write(reinterpret_cast<char*>(&file_header), sizeof(file_header));
+	}
+
+	dense_writer(const dense_writer&) = delete;
+	dense_writer& operator=(const dense_writer&) = delete;
+
+	~dense_writer() {
+		if (ofs.is_open()) {
+			ofs.close();
+		}
+	}
+
+	// Append the columns [num_columns_written(), num_columns_written() + ncols) of the matrix
+	void append_columns(
+			const T* const ptr,
+			const std::uint64_t ld,
+			const std::uint64_t ncols,
+			const op_t op = op_t::no_transpose
+			) {
+		if (!ofs.is_open()) {
+			throw std::runtime_error("[matfile error] The writer is already closed : " + mat_name);
+		}
+		if (num_written_cols + ncols > n) {
+			throw std::runtime_error("[matfile error] Too many columns are appended to " + mat_name + " (" + std::to_string(num_written_cols + ncols) + " > " + std::to_string(n) + ")");
+		}
+		detail::save_dense_core<T, MATFILE_T>(ofs, ptr, m, ncols, ld, op, convert_t::cast);
+		if (!ofs) {
+			throw std::runtime_error("[matfile error] Failed to write : " + mat_name);
+		}
+		num_written_cols += ncols;
+	}
+
+	// Close the file after checking that all n columns have been appended
+	void close() {
+		if (!ofs.is_open()) {
+			return;
+		}
+		ofs.close();
+		if (num_written_cols != n) {
+			throw std::runtime_error("[matfile error] Only " + std::to_string(num_written_cols) + " of " + std::to_string(n) + " columns were written to " + mat_name);
+		}
+		if (!ofs) {
+			throw std::runtime_error("[matfile error] Failed to write : " + mat_name);
+		}
+	}
+
+	std::uint64_t num_columns_written() const {return num_written_cols;}
+};
+
+// Reader for processing a dense matrix column panel by column panel
+template <class T>
+class dense_reader {
+	int fd;
+	const std::string mat_name;
+	detail::file_header file_header;
+	const std::uint64_t panel_width;
+	const bool prefetch;
+
+	// The first column of the panel read by the next call
+	std::uint64_t next_col;
+
+	// Double buffer for next_panel()
+	std::unique_ptr<T[]> buffers[2];
+	unsigned current_buffer;
+	std::uint64_t current_col0;
+	std::uint64_t current_cols;
+
+	// Panel being prefetched on the background
+	std::future<detail::read_status> pending;
+	unsigned pending_buffer;
+	std::uint64_t pending_col0;
+	std::uint64_t pending_cols;
+
+	detail::read_status load(
+			T* const ptr,
+			const std::uint64_t ld,
+			const std::uint64_t col0,
+			const std::uint64_t cols
+			) const {
+		return detail::load_dense_window(ptr, fd, file_header, 0, col0, file_header.m, cols, ld, op_t::no_transpose, convert_t::cast, 1);
+	}
+
+	T* get_buffer(const unsigned i) {
+		if (!buffers[i]) {
+			buffers[i].reset(new T[file_header.m * panel_width]);
+		}
+		return buffers[i].get();
+	}
+
+	void wait_pending() {
+		detail::check_read_status(pending.get(), mat_name);
+	}
+public:
+	dense_reader(
+			const std::string mat_name,
+			const std::uint64_t panel_width,
+			const bool prefetch = false
+			) : mat_name(mat_name), panel_width(std::max<std::uint64_t>(1, panel_width)), prefetch(prefetch),
+	next_col(0), current_buffer(0), current_col0(0), current_cols(0) {
+		fd = open(mat_name.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("[matfile error] No such file : " + mat_name);
+		}
+		if (!detail::pread_all(fd, &file_header, sizeof(file_header), 0)) {
+			close(fd);
+			throw std::runtime_error("[matfile error] Failed to read : " + mat_name);
+		}
+		if (file_header.matrix_type != matrix_t::dense) {
+			close(fd);
+			throw std::runtime_error("[matfile error] Not a dense matrix : " + mat_name);
+		}
+	}
+
+	dense_reader(const dense_reader&) = delete;
+	dense_reader& operator=(const dense_reader&) = delete;
+
+	~dense_reader() {
+		if (pending.valid()) {
+			pending.wait();
+		}
+		close(fd);
+	}
+
+	std::uint64_t m() const {return file_header.m;}
+	std::uint64_t n() const {return file_header.n;}
+	data_t data_type() const {return file_header.data_type;}
+
+	// Read the next panel to the caller-provided buffer `ptr`.
+	// The return value is the number of columns read and 0 at the end of the matrix.
+	std::uint64_t read_panel(
+			T* const ptr,
+			const std::uint64_t ld
+			) {
+		if (pending.valid()) {
+			wait_pending();
+			detail::scatter_panel(ptr, ld, buffers[pending_buffer].get(), file_header.m, file_header.m, pending_cols, op_t::no_transpose, convert_t::cast);
+			next_col = pending_col0 + pending_cols;
+			return pending_cols;
+		}
+		if (next_col >= file_header.n) {
+			return 0;
+		}
+		const auto cols = std::min(panel_width, file_header.n - next_col);
+		detail::check_read_status(load(ptr, ld, next_col, cols), mat_name);
+		next_col += cols;
+		return cols;
+	}
+
+	// Read the next panel to the internal buffer, which can be accessed through panel_data() until the next call.
+	// When prefetch is enabled, the following panel is read on a background thread meanwhile.
+	// The return value is the number of columns read and 0 at the end of the matrix.
+	std::uint64_t next_panel() {
+		if (pending.valid()) {
+			wait_pending();
+			current_buffer = pending_buffer;
+			current_col0 = pending_col0;
+			current_cols = pending_cols;
+		} else {
+			if (next_col >= file_header.n) {
+				current_cols = 0;
+				return 0;
+			}
+			current_buffer = 1 - current_buffer;
+			current_col0 = next_col;
+			current_cols = std::min(panel_width, file_header.n - next_col);
+			detail::check_read_status(load(get_buffer(current_buffer), file_header.m, current_col0, current_cols), mat_name);
+		}
+		next_col = current_col0 + current_cols;
+
+		if (prefetch && next_col < file_header.n) {
+			pending_buffer = 1 - current_buffer;
+			pending_col0 = next_col;
+			pending_cols = std::min(panel_width, file_header.n - next_col);
+			T* const ptr = get_buffer(pending_buffer);
+			pending = std::async(std::launch::async, [this, ptr]() {
+				return load(ptr, file_header.m, pending_col0, pending_cols);
+			});
+		}
+		return current_cols;
+	}
+
+	// The panel read by the last next_panel() call (m x panel_cols(), leading dimension m)
+	const T* panel_data() const {return buffers[current_buffer].get();}
+	std::uint64_t panel_col0() const {return current_col0;}
+	std::uint64_t panel_cols() const {return current_cols;}
+};
+
+enum class mmap_hint_t {
+	normal,
+	sequential,
+	random,
+	populate
+};
+
+namespace detail {
+// Map the whole file read-only. The caller unmaps it.
+inline void* map_matfile(
+		const std::string mat_name,
+		const mmap_hint_t hint,
+		std::size_t& map_size
+		) {
+	const int fd = open(mat_name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("[matfile error] No such file : " + mat_name);
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(file_header)) {
+		close(fd);
+		throw std::runtime_error("[matfile error] Invalid file : " + mat_name);
+	}
+	map_size = st.st_size;
+
+	int flags = MAP_SHARED;
+	if (hint == mmap_hint_t::populate) {
+		flags |= MAP_POPULATE;
+	}
+	const auto map_ptr = mmap(nullptr, map_size, PROT_READ, flags, fd, 0);
+	close(fd);
+	if (map_ptr == MAP_FAILED) {
+		throw std::runtime_error("[matfile error] Failed to map : " + mat_name);
+	}
+
+	if (hint == mmap_hint_t::sequential) {
+		madvise(map_ptr, map_size, MADV_SEQUENTIAL);
+	} else if (hint == mmap_hint_t::random) {
+		madvise(map_ptr, map_size, MADV_RANDOM);
+	}
+	return map_ptr;
+}
+} // namespace detail
+
+// Read-only view of a dense matfile backed by a memory mapping of the file
+template <class T>
+class mapped_dense {
+	void* map_ptr;
+	std::size_t map_size;
+	detail::file_header file_header;
+
+	void unmap() {
+		if (map_ptr != nullptr) {
+			munmap(map_ptr, map_size);
+			map_ptr = nullptr;
+		}
+	}
+public:
+	mapped_dense(
+			const std::string mat_name,
+			const mmap_hint_t hint = mmap_hint_t::normal
+			) : map_ptr(nullptr), map_size(0) {
+		map_ptr = detail::map_matfile(mat_name, hint, map_size);
+		std::memcpy(&file_header, map_ptr, sizeof(file_header));
+		if (file_header.matrix_type != matrix_t::dense) {
+			unmap();
+			throw std::runtime_error("[matfile error] Not a dense matrix : " + mat_name);
+		}
+		if (detail::is_encoded(file_header)) {
+			unmap();
+			throw std::runtime_error("[matfile error] An encoded matrix cannot be mapped : " + mat_name);
+		}
+		if (file_header.data_type != detail::get_data_type<T>()) {
+			unmap();
+			throw std::runtime_error("[matfile error] Data type mismatch : " + mat_name + " (" + detail::get_data_type_str(file_header.data_type) + " is stored but " + detail::get_type_name_str<T>() + " is requested)");
+		}
+		// m * n * sizeof(T) of a corrupted header can overflow, so it is compared by division
+		if (file_header.n != 0 && file_header.m > (map_size - sizeof(file_header)) / sizeof(T) / file_header.n) {
+			unmap();
+			throw std::runtime_error("[matfile error] Truncated file : " + mat_name);
+		}
+	}
+
+	mapped_dense(const mapped_dense&) = delete;
+	mapped_dense& operator=(const mapped_dense&) = delete;
+
+	mapped_dense(mapped_dense&& o) noexcept
+		: map_ptr(o.map_ptr), map_size(o.map_size), file_header(o.file_header) {
+		o.map_ptr = nullptr;
+	}
+	mapped_dense& operator=(mapped_dense&& o) noexcept {
+		if (this != &o) {
+			unmap();
+			map_ptr = o.map_ptr;
+			map_size = o.map_size;
+			file_header = o.file_header;
+			o.map_ptr = nullptr;
+		}
+		return *this;
+	}
+
+	~mapped_dense() {
+		unmap();
+	}
+
+	std::uint64_t m() const {return file_header.m;}
+	std::uint64_t n() const {return file_header.n;}
+	std::uint64_t ld() const {return file_header.m;}
+	const detail::file_header& header() const {return file_header;}
+
+	const T* data() const {
+		return reinterpret_cast<const T*>(reinterpret_cast<const char*>(map_ptr) + sizeof(file_header));
+	}
+
+	const T& operator()(
+			const std::size_t i,
+			const std::size_t j
+			) const {
+		return data()[i + j * ld()];
+	}
+};
+
+// Sparse matrices (0-based indices)
+template <class T, class INDEX_T = std::uint64_t>
+struct coo_matrix {
+	std::size_t m = 0;
+	std::size_t n = 0;
+	std::vector<INDEX_T> row_index;
+	std::vector<INDEX_T> col_index;
+	std::vector<T> values;
+
+	std::size_t nnz() const {return values.size();}
+};
+
+template <class T, class INDEX_T = std::uint64_t>
+struct csr_matrix {
+	std::size_t m = 0;
+	std::size_t n = 0;
+	// m + 1 elements
+	std::vector<INDEX_T> row_ptr;
+	std::vector<INDEX_T> col_index;
+	std::vector<T> values;
+
+	std::size_t nnz() const {return values.size();}
+};
+
+template <class T, class INDEX_T = std::uint64_t>
+struct csc_matrix {
+	std::size_t m = 0;
+	std::size_t n = 0;
+	// n + 1 elements
+	std::vector<INDEX_T> col_ptr;
+	std::vector<INDEX_T> row_index;
+	std::vector<T> values;
+
+	std::size_t nnz() const {return values.size();}
+};
+
+namespace detail {
+// Compress the (major, minor) coordinates into major pointers.
+// When `sort_and_sum` is true, the minor indices are sorted in each major line and duplicates are summed.
+template <class T, class INDEX_T>
+void compress_coordinates(
+		const std::size_t num_major,
+		const std::vector<INDEX_T>& major_index,
+		const std::vector<INDEX_T>& minor_index,
+		const std::vector<T>& values,
+		std::vector<INDEX_T>& ptr,
+		std::vector<INDEX_T>& out_minor_index,
+		std::vector<T>& out_values,
+		const bool sort_and_sum
+		) {
+	const auto nnz = values.size();
+	ptr.assign(num_major + 1, 0);
+	for (std::size_t k = 0; k < nnz; k++) {
+		ptr[major_index[k] + 1]++;
+	}
+	for (std::size_t i = 0; i < num_major; i++) {
+		ptr[i + 1] += ptr[i];
+	}
+
+	out_minor_index.resize(nnz);
+	out_values.resize(nnz);
+	{
+		std::vector<INDEX_T> pos(ptr.begin(), ptr.end() - 1);
+		for (std::size_t k = 0; k < nnz; k++) {
+			const auto p = pos[major_index[k]]++;
+			out_minor_index[p] = minor_index[k];
+			out_values[p] = values[k];
+		}
+	}
+	if (!sort_and_sum) {
+		return;
+	}
+
+	// Sort each line and sum duplicates in place, then close the gaps
+	std::vector<INDEX_T> count(num_major);
+MATFILE_OMP(omp parallel)
+	{
+		std::vector<std::pair<INDEX_T, T>> line;
+MATFILE_OMP(omp for schedule(dynamic, 64))
+		for (std::int64_t i = 0; i < static_cast<std::int64_t>(num_major); i++) {
+			line.clear();
+			for (auto p = ptr[i]; p < ptr[i + 1]; p++) {
+				line.emplace_back(out_minor_index[p], out_values[p]);
+			}
+			std::stable_sort(line.begin(), line.end(), [](const auto& a, const auto& b) {return a.first < b.first;});
+			auto p = ptr[i];
+			for (std::size_t k = 0; k < line.size(); k++) {
+				if (k != 0 && line[k].first == line[k - 1].first) {
+					out_values[p - 1] += line[k].second;
+					continue;
+				}
+				out_minor_index[p] = line[k].first;
+				out_values[p] = line[k].second;
+				p++;
+			}
+			count[i] = p - ptr[i];
+		}
+	}
+	INDEX_T new_nnz = 0;
+	for (std::size_t i = 0; i < num_major; i++) {
+		const auto begin = ptr[i];
+		ptr[i] = new_nnz;
+		for (INDEX_T k = 0; k < count[i]; k++) {
+			out_minor_index[new_nnz + k] = out_minor_index[begin + k];
+			out_values[new_nnz + k] = out_values[begin + k];
+		}
+		new_nnz += count[i];
+	}
+	ptr[num_major] = new_nnz;
+	out_minor_index.resize(new_nnz);
+	out_values.resize(new_nnz);
+}
+} // namespace detail
+
+template <class T, class INDEX_T>
+csr_matrix<T, INDEX_T> to_csr(
+		const coo_matrix<T, INDEX_T>& coo,
+		const bool sort_and_sum = true
+		) {
+	csr_matrix<T, INDEX_T> csr;
+	csr.m = coo.m;
+	csr.n = coo.n;
+	detail::compress_coordinates(coo.m, coo.row_index, coo.col_index, coo.values, csr.row_ptr, csr.col_index, csr.values, sort_and_sum);
+	return csr;
+}
+
+template <class T, class INDEX_T>
+csc_matrix<T, INDEX_T> to_csc(
+		const coo_matrix<T, INDEX_T>& coo,
+		const bool sort_and_sum = true
+		) {
+	csc_matrix<T, INDEX_T> csc;
+	csc.m = coo.m;
+	csc.n = coo.n;
+	detail::compress_coordinates(coo.n, coo.col_index, coo.row_index, coo.values, csc.col_ptr, csc.row_index, csc.values, sort_and_sum);
+	return csc;
+}
+
+namespace detail {
+// Layout of a sparse matfile:
+//   header (a0 = nnz, a1 = index size in bytes)
+//   pointers (num_major + 1 indices)
+//   indices  (nnz indices)
+//   values   (nnz elements of data_type)
+// Each section starts at an offset aligned to direct_io_alignment so that it can be mapped and used directly.
+struct sparse_layout {
+	std::size_t num_major;
+	std::size_t nnz;
+	std::size_t index_size;
+	std::size_t ptr_offset;
+	std::size_t index_offset;
+	std::size_t value_offset;
+	std::size_t file_size;
+};
+
+inline bool is_sparse(
+		const matrix_t matrix_type
+		) {
+	return matrix_type == matrix_t::csr || matrix_type == matrix_t::csc;
+}
+
+inline sparse_layout get_sparse_layout(
+		const file_header& header
+		) {
+	sparse_layout layout;
+	layout.num_major = header.matrix_type == matrix_t::csr ? header.m : header.n;
+	layout.nnz = header.a0;
+	layout.index_size = header.a1;
+	layout.ptr_offset = align_up(sizeof(file_header));
+	layout.index_offset = align_up(layout.ptr_offset + (layout.num_major + 1) * layout.index_size);
+	layout.value_offset = align_up(layout.index_offset + layout.nnz * layout.index_size);
+	layout.file_size = layout.value_offset + layout.nnz * get_dtype_size(header.data_type);
+	return layout;
+}
+
+// Whether the layout of a possibly corrupted header fits in `size` bytes.
+// Each array is bounded by `size` first so that the offsets cannot overflow.
+inline bool fits_sparse_layout(
+		const file_header& header,
+		const std::size_t size
+		) {
+	const std::uint64_t num_major = header.matrix_type == matrix_t::csr ? header.m : header.n;
+	const std::uint64_t index_size = header.a1;
+	const std::uint64_t value_size = get_dtype_size(header.data_type);
+	if (index_size == 0 || value_size == 0 || num_major >= size / index_size || header.a0 > size / index_size || header.a0 > size / value_size) {
+		return false;
+	}
+	return get_sparse_layout(header).file_size <= size;
+}
+
+// The narrowest index width which can hold nnz and the matrix shape
+inline std::size_t get_sparse_index_size(
+		const std::uint64_t m,
+		const std::uint64_t n,
+		const std::uint64_t nnz
+		) {
+	constexpr std::uint64_t max_u32 = 0xffffffffu;
+	return (std::max({m, n, nnz}) <= max_u32) ? 4 : 8;
+}
+
+// Write `count` elements of SRC_T as DST_T at `offset` in blocks of io_buffer_size
+template <class DST_T, class SRC_T>
+bool pwrite_converted(
+		const int fd,
+		const SRC_T* const src,
+		const std::size_t count,
+		const std::size_t offset
+		) {
+	if (std::is_same<DST_T, SRC_T>::value) {
+		return pwrite_all(fd, src, count * sizeof(SRC_T), offset);
+	}
+	const auto block = std::max<std::size_t>(1, io_buffer_size / sizeof(DST_T));
+	std::unique_ptr<DST_T[]> buffer(new DST_T[std::min(block, count)]);
+	for (std::size_t i = 0; i < count; i += block) {
+		const auto c = std::min(block, count - i);
+		convert_array(buffer.get(), src + i, c, convert_t::cast);
+		if (!pwrite_all(fd, buffer.get(), c * sizeof(DST_T), offset + i * sizeof(DST_T))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Read `count` elements of SRC_T at `offset` as DST_T converted with `convert`, splitting the blocks among `num_threads` threads
+template <class DST_T, class SRC_T>
+bool pread_converted(
+		const int fd,
+		DST_T* const dst,
+		const std::size_t count,
+		const std::size_t offset,
+		const convert_t convert,
+		[[maybe_unused]] const unsigned num_threads
+		) {
+	const auto block = std::max<std::size_t>(1, io_buffer_size / sizeof(SRC_T));
+	const std::int64_t num_blocks = (count + block - 1) / block;
+	bool succeeded = true;
+MATFILE_OMP(omp parallel num_threads(num_threads) if(num_threads > 1 && num_blocks > 1))
+	{
+		std::unique_ptr<SRC_T[]> buffer;
+MATFILE_OMP(omp for schedule(dynamic))
+		for (std::int64_t b = 0; b < num_blocks; b++) {
+			const std::size_t i = b * block;
+			const auto c = std::min(block, count - i);
+			bool s;
+			if (std::is_same<DST_T, SRC_T>::value) {
+				s = pread_all(fd, dst + i, c * sizeof(SRC_T), offset + i * sizeof(SRC_T));
+			} else {
+				if (!buffer) {
+					buffer.reset(new SRC_T[block]);
+				}
+				s = pread_all(fd, buffer.get(), c * sizeof(SRC_T), offset + i * sizeof(SRC_T));
+				if (s) {
+					convert_array(dst + i, buffer.get(), c, convert);
+				}
+			}
+			if (!s) {
+MATFILE_OMP(omp atomic write)
+				succeeded = false;
+			}
+		}
+	}
+	return succeeded;
+}
+
+template <class T, class MATFILE_T, class INDEX_T>
+void save_sparse(
+		const matrix_t matrix_type,
+		const std::uint64_t m,
+		const std::uint64_t n,
+		const INDEX_T* const ptr,
+		const INDEX_T* const index,
+		const T* const values,
+		const std::string mat_name
+		) {
+	file_header header{};
+#ifndef MATFILE_USE_OLD_FORMAT
+	header.version = get_version_uint32(0, 8);
+#endif
+	header.data_type = get_data_type<MATFILE_T>();
+	header.matrix_type = matrix_type;
+	header.m = m;
+	header.n = n;
+	const auto num_major = matrix_type == matrix_t::csr ? m : n;
+	header.a0 = ptr[num_major];
+	header.a1 = get_sparse_index_size(m, n, header.a0);
+	const auto layout = get_sparse_layout(header);
+
+	const int fd = open(mat_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		throw std::runtime_error("[matfile error] Failed to open : " + mat_name);
+	}
+	bool succeeded = pwrite_all(fd, &header, sizeof(header), 0);
+	if (layout.index_size == 4) {
+		succeeded = succeeded && pwrite_converted<std::uint32_t>(fd, ptr, num_major + 1, layout.ptr_offset);
+		succeeded = succeeded && pwrite_converted<std::uint32_t>(fd, index, layout.nnz, layout.index_offset);
+	} else {
+		succeeded = succeeded && pwrite_converted<std::uint64_t>(fd, ptr, num_major + 1, layout.ptr_offset);
+		succeeded = succeeded && pwrite_converted<std::uint64_t>(fd, index, layout.nnz, layout.index_offset);
+	}
+	succeeded = succeeded && pwrite_converted<MATFILE_T>(fd, values, layout.nnz, layout.value_offset);
+	// The padding between the sections is left as a hole
+	succeeded = succeeded && ftruncate(fd, layout.file_size) == 0;
+	close(fd);
+	if (!succeeded) {
+		throw std::runtime_error("[matfile error] Failed to write : " + mat_name);
+	}
+}
+
+template <class T, class INDEX_T>
+void load_sparse(
+		const matrix_t matrix_type,
+		std::uint64_t& m,
+		std::uint64_t& n,
+		std::vector<INDEX_T>& ptr,
+		std::vector<INDEX_T>& index,
+		std::vector<T>& values,
+		const std::string mat_name,
+		const convert_t convert,
+		const unsigned num_threads
+		) {
+	const int fd = open(mat_name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("[matfile error] No such file : " + mat_name);
+	}
+	file_header header;
+	if (!pread_all(fd, &header, sizeof(header), 0)) {
+		close(fd);
+		throw std::runtime_error("[matfile error] Failed to read : " + mat_name);
+	}
+	if (header.matrix_type != matrix_type) {
+		close(fd);
+		throw std::runtime_error(std::string("[matfile error] Not a ") + (matrix_type == matrix_t::csr ? "CSR" : "CSC") + " matrix : " + mat_name);
+	}
+	const auto layout = get_sparse_layout(header);
+	if (static_cast<std::uint64_t>(std::max({header.m, header.n, header.a0})) > static_cast<std::uint64_t>(std::numeric_limits<INDEX_T>::max())) {
+		close(fd);
+		throw std::runtime_error("[matfile error] The index type " + detail::get_type_name_str<INDEX_T>() + " is too narrow for " + mat_name);
+	}
+
+	m = header.m;
+	n = header.n;
+	ptr.resize(layout.num_major + 1);
+	index.resize(layout.nnz);
+	values.resize(layout.nnz);
+	const auto nt = std::max(1u, num_threads);
+	bool succeeded = true;
+	if (layout.index_size == 4) {
+		succeeded = succeeded && pread_converted<INDEX_T, std::uint32_t>(fd, ptr.data(), ptr.size(), layout.ptr_offset, convert_t::cast, nt);
+		succeeded = succeeded && pread_converted<INDEX_T, std::uint32_t>(fd, index.data(), index.size(), layout.index_offset, convert_t::cast, nt);
+	} else if (layout.index_size == 8) {
+		succeeded = succeeded && pread_converted<INDEX_T, std::uint64_t>(fd, ptr.data(), ptr.size(), layout.ptr_offset, convert_t::cast, nt);
+		succeeded = succeeded && pread_converted<INDEX_T, std::uint64_t>(fd, index.data(), index.size(), layout.index_offset, convert_t::cast, nt);
+	} else {
+		succeeded = false;
+	}
+	dispatch_data_type(header.data_type, [&](const auto tag) {
+		using MATFILE_T = typename decltype(tag)::type;
+		succeeded = succeeded && pread_converted<T, MATFILE_T>(fd, values.data(), values.size(), layout.value_offset, convert, nt);
+	});
+	close(fd);
+	if (!succeeded) {
+		throw std::runtime_error("[matfile error] Failed to read : " + mat_name);
+	}
+}
+} // namespace detail
+
+template <class T, class MATFILE_T = T, class INDEX_T>
+void save_csr(
+		const std::uint64_t m,
+		const std::uint64_t n,
+		const INDEX_T* const row_ptr,
+		const INDEX_T* const col_index,
+		const T* const values,
+		const std::string mat_name
+		) {
+	detail::save_sparse<T, MATFILE_T>(matrix_t::csr, m, n, row_ptr, col_index, values, mat_name);
+}
+
+template <class T, class MATFILE_T = T, class INDEX_T>
+void save_csr(
+		const csr_matrix<T, INDEX_T>& mat,
+		const std::string mat_name
+		) {
+	save_csr<T, MATFILE_T>(mat.m, mat.n, mat.row_ptr.data(), mat.col_index.data(), mat.values.data(), mat_name);
+}
+
+template <class T, class MATFILE_T = T, class INDEX_T>
+void save_csc(
+		const std::uint64_t m,
+		const std::uint64_t n,
+		const INDEX_T* const col_ptr,
+		const INDEX_T* const row_index,
+		const T* const values,
+		const std::string mat_name
+		) {
+	detail::save_sparse<T, MATFILE_T>(matrix_t::csc, m, n, col_ptr, row_index, values, mat_name);
+}
+
+template <class T, class MATFILE_T = T, class INDEX_T>
+void save_csc(
+		const csc_matrix<T, INDEX_T>& mat,
+		const std::string mat_name
+		) {
+	save_csc<T, MATFILE_T>(mat.m, mat.n, mat.col_ptr.data(), mat.row_index.data(), mat.values.data(), mat_name);
+}
+
+// The values and indices are converted to T and INDEX_T
+template <class T, class INDEX_T = std::uint64_t>
+csr_matrix<T, INDEX_T> load_csr(
+		const std::string mat_name,
+		const io_options options = io_options{}
+		) {
+	csr_matrix<T, INDEX_T> mat;
+	std::uint64_t m, n;
+	detail::load_sparse(matrix_t::csr, m, n, mat.row_ptr, mat.col_index, mat.values, mat_name, options.convert, options.num_threads);
+	mat.m = m;
+	mat.n = n;
+	return mat;
+}
+
+template <class T, class INDEX_T = std::uint64_t>
+csc_matrix<T, INDEX_T> load_csc(
+		const std::string mat_name,
+		const io_options options = io_options{}
+		) {
+	csc_matrix<T, INDEX_T> mat;
+	std::uint64_t m, n;
+	detail::load_sparse(matrix_t::csc, m, n, mat.col_ptr, mat.row_index, mat.values, mat_name, options.convert, options.num_threads);
+	mat.m = m;
+	mat.n = n;
+	return mat;
+}
+
+// Read-only view of a CSR/CSC matfile backed by a memory mapping of the file.
+// T and INDEX_T must be the stored types since no conversion is done.
+template <class T, class INDEX_T, matrix_t MATRIX_T>
+class mapped_sparse {
+	static_assert(MATRIX_T == matrix_t::csr || MATRIX_T == matrix_t::csc, "MATRIX_T must be csr or csc");
+
+	void* map_ptr;
+	std::size_t map_size;
+	detail::file_header file_header;
+	detail::sparse_layout layout;
+
+	void unmap() {
+		if (map_ptr != nullptr) {
+			munmap(map_ptr, map_size);
+			map_ptr = nullptr;
+		}
+	}
+
+	const char* at(const std::size_t offset) const {
+		return reinterpret_cast<const char*>(map_ptr) + offset;
+	}
+public:
+	mapped_sparse(
+			const std::string mat_name,
+			const mmap_hint_t hint = mmap_hint_t::normal
+			) : map_ptr(nullptr), map_size(0) {
+		map_ptr = detail::map_matfile(mat_name, hint, map_size);
+		std::memcpy(&file_header, map_ptr, sizeof(file_header));
+		if (file_header.matrix_type != MATRIX_T) {
+			unmap();
+			throw std::runtime_error(std::string("[matfile error] Not a ") + (MATRIX_T == matrix_t::csr ? "CSR" : "CSC") + " matrix : " + mat_name);
+		}
+		if (file_header.data_type != detail::get_data_type<T>()) {
+			unmap();
+			throw std::runtime_error("[matfile error] Data type mismatch : " + mat_name + " (" + detail::get_data_type_str(file_header.data_type) + " is stored but " + detail::get_type_name_str<T>() + " is requested)");
+		}
+		if (file_header.a1 != sizeof(INDEX_T)) {
+			unmap();
+			throw std::runtime_error("[matfile error] Index type mismatch : " + mat_name + " (" + std::to_string(file_header.a1 * 8) + "-bit indices are stored but " + detail::get_type_name_str<INDEX_T>() + " is requested)");
+		}
+		if (!detail::fits_sparse_layout(file_header, map_size)) {
+			unmap();
+			throw std::runtime_error("[matfile error] Truncated file : " + mat_name);
+		}
+		layout = detail::get_sparse_layout(file_header);
+	}
+
+	mapped_sparse(const mapped_sparse&) = delete;
+	mapped_sparse& operator=(const mapped_sparse&) = delete;
+
+	mapped_sparse(mapped_sparse&& o) noexcept
+		: map_ptr(o.map_ptr), map_size(o.map_size), file_header(o.file_header), layout(o.layout) {
+		o.map_ptr = nullptr;
+	}
+	mapped_sparse& operator=(mapped_sparse&& o) noexcept {
+		if (this != &o) {
+			unmap();
+			map_ptr = o.map_ptr;
+			map_size = o.map_size;
+			file_header = o.file_header;
+			layout = o.layout;
+			o.map_ptr = nullptr;
+		}
+		return *this;
+	}
+
+	~mapped_sparse() {
+		unmap();
+	}
+
+	std::uint64_t m() const {return file_header.m;}
+	std::uint64_t n() const {return file_header.n;}
+	std::uint64_t nnz() const {return layout.nnz;}
+	const detail::file_header& header() const {return file_header;}
+
+	// row_ptr/col_index for CSR, col_ptr/row_index for CSC
+	const INDEX_T* ptr() const {return reinterpret_cast<const INDEX_T*>(at(layout.ptr_offset));}
+	const INDEX_T* index() const {return reinterpret_cast<const INDEX_T*>(at(layout.index_offset));}
+	const T* values() const {return reinterpret_cast<const T*>(at(layout.value_offset));}
+};
+
+template <class T, class INDEX_T = std::uint32_t>
+using mapped_csr = mapped_sparse<T, INDEX_T, matrix_t::csr>;
+template <class T, class INDEX_T = std::uint32_t>
+using mapped_csc = mapped_sparse<T, INDEX_T, matrix_t::csc>;
+
+namespace matrix_market {
+namespace detail {
+using matrix_type_t = unsigned;
+constexpr matrix_type_t unsupported_matrix = 0;
+constexpr matrix_type_t general_matrix   = 1;
+constexpr matrix_type_t symmetric_matrix = 2;
+constexpr matrix_type_t skew_symmetric_matrix = 3;
+constexpr matrix_type_t hermitian_matrix = 4;
+
+using element_type_t = unsigned;
+constexpr element_type_t unsupported_value = 0;
+constexpr element_type_t real_value = 1;
+constexpr element_type_t pattern_value = 2;
+constexpr element_type_t integer_value = 3;
+constexpr element_type_t complex_value = 4;
+
+// The banner is expected in lower case
+inline matrix_type_t get_matrix_type(
+		const std::string banner
+		) {
+	if (banner.find("general") != std::string::npos) {
+		return general_matrix;
+	} else if (banner.find("skew-symmetric") != std::string::npos) {
+		return skew_symmetric_matrix;
+	} else if (banner.find("symmetric") != std::string::npos) {
+		return symmetric_matrix;
+	} else if (banner.find("hermitian") != std::string::npos) {
+		return hermitian_matrix;
+	}
+	return unsupported_matrix;
+}
+
+inline element_type_t get_element_type(
+		const std::string banner
+		) {
+	if (banner.find("real") != std::string::npos || banner.find("double") != std::string::npos) {
+		return real_value;
+	} else if (banner.find("pattern") != std::string::npos) {
+		return pattern_value;
+	} else if (banner.find("integer") != std::string::npos) {
+		return integer_value;
+	} else if (banner.find("complex") != std::string::npos) {
+		return complex_value;
+	}
+	return unsupported_value;
+}
+
+inline bool is_array_format(
+		const std::string banner
+		) {
+	return banner.find("array") != std::string::npos;
+}
+
+template <class T>
+struct is_complex : std::false_type {};
+template <class T>
+struct is_complex<std::complex<T>> : std::true_type {};
+
+// Convert a parsed value (double, std::int64_t or std::complex<double>) to T
+template <class T, class V>
+inline T cast_value(
+		const V v
+		) {
+	if constexpr (is_complex<T>::value) {
+		if constexpr (is_complex<V>::value) {
+			return T(v.real(), v.imag());
+		} else {
+			return T(v);
+		}
+	} else if constexpr (is_complex<V>::value) {
+		// Complex files are rejected before parsing when T is real
+		return static_cast<T>(v.real());
+	} else {
+		return static_cast<T>(v);
+	}
+}
+
+// The value at (j, i) of a symmetric, skew-symmetric or hermitian matrix whose (i, j) value is `v`
+template <class V>
+inline V get_mirrored_value(
+		const V v,
+		const matrix_type_t matrix_type
+		) {
+	if (matrix_type == skew_symmetric_matrix) {
+		return -v;
+	}
+	if constexpr (is_complex<V>::value) {
+		if (matrix_type == hermitian_matrix) {
+			return std::conj(v);
+		}
+	}
+	return v;
+}
+
+// Read-only memory mapping of a whole text file
+class mapped_file {
+	void* map_ptr;
+	std::size_t map_size;
+public:
+	mapped_file(
+			const std::string filepath
+			) : map_ptr(nullptr), map_size(0) {
+		const int fd = open(filepath.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("[matfile error] No such file : " + filepath);
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			close(fd);
+			throw std::runtime_error("[matfile error] Failed to read : " + filepath);
+		}
+		map_size = st.st_size;
+		if (map_size != 0) {
+			map_ptr = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (map_ptr == MAP_FAILED) {
+				close(fd);
+				throw std::runtime_error("[matfile error] Failed to map : " + filepath);
+			}
+			madvise(map_ptr, map_size, MADV_SEQUENTIAL);
+		}
+		close(fd);
+	}
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+	~mapped_file() {
+		if (map_ptr != nullptr) {
+			munmap(map_ptr, map_size);
+		}
+	}
+
+	const char* begin() const {return reinterpret_cast<const char*>(map_ptr);}
+	const char* end() const {return begin() + map_size;}
+};
+
+inline const char* find_line_end(
+		const char* const p,
+		const char* const end
+		) {
+	const auto q = reinterpret_cast<const char*>(std::memchr(p, '\n', end - p));
+	return q == nullptr ? end : q;
+}
+
+inline const char* skip_spaces(
+		const char* p,
+		const char* const end
+		) {
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+		p++;
+	}
+	return p;
+}
+
+// The parse functions return nullptr when the text is malformed
+inline const char* parse_uint(
+		const char* p,
+		const char* const end,
+		std::size_t& v
+		) {
+	p = skip_spaces(p, end);
+	if (p == end || *p < '0' || *p > '9') {
+		return nullptr;
+	}
+	v = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++) {
+		v = v * 10 + (*p - '0');
+	}
+	return p;
+}
+
+inline const char* parse_real(
+		const char* p,
+		const char* const end,
+		double& v
+		) {
+	p = skip_spaces(p, end);
+	if (p < end && *p == '+') {
+		p++;
+	}
+	const auto res = std::from_chars(p, end, v);
+	if (res.ec != std::errc()) {
+		return nullptr;
+	}
+	return res.ptr;
+}
+
+inline const char* parse_value(
+		const char* p,
+		const char* const end,
+		double& v
+		) {
+	return parse_real(p, end, v);
+}
+
+inline const char* parse_value(
+		const char* p,
+		const char* const end,
+		std::int64_t& v
+		) {
+	p = skip_spaces(p, end);
+	if (p < end && *p == '+') {
+		p++;
+	}
+	const auto res = std::from_chars(p, end, v);
+	if (res.ec != std::errc()) {
+		return nullptr;
+	}
+	return res.ptr;
+}
+
+// The real and imaginary parts are written side by side
+inline const char* parse_value(
+		const char* p,
+		const char* const end,
+		std::complex<double>& v
+		) {
+	double re, im;
+	if ((p = parse_real(p, end, re)) == nullptr || (p = parse_real(p, end, im)) == nullptr) {
+		return nullptr;
+	}
+	v = std::complex<double>(re, im);
+	return p;
+}
+
+struct file_info {
+	matrix_type_t matrix_type;
+	element_type_t element_type;
+	bool is_array;
+	std::size_t m;
+	std::size_t n;
+	std::size_t num_elements;
+	// The beginning of the entry section
+	const char* entries;
+};
+
+inline file_info parse_file_info(
+		const char* const begin,
+		const char* const end,
+		const std::string filepath
+		) {
+	file_info info;
+	const auto banner_end = find_line_end(begin, end);
+	std::string banner(begin, banner_end);
+	std::transform(banner.begin(), banner.end(), banner.begin(), [](const unsigned char c) {return std::tolower(c);});
+	info.matrix_type = get_matrix_type(banner);
+	info.element_type = get_element_type(banner);
+	info.is_array = is_array_format(banner);
+
+	const char* p = banner_end;
+	for (; p < end; p = find_line_end(p, end)) {
+		p++;
+		const auto q = skip_spaces(p, end);
+		if (q < end && *q != '%' && *q != '\n') {
+			break;
+		}
+	}
+	const auto size_line_end = find_line_end(std::min(p, end), end);
+	const char* q = p;
+	if (
+		p >= end ||
+		(q = parse_uint(q, size_line_end, info.m)) == nullptr ||
+		(q = parse_uint(q, size_line_end, info.n)) == nullptr ||
+		(!info.is_array && (q = parse_uint(q, size_line_end, info.num_elements)) == nullptr)
+		) {
+		throw std::runtime_error("[matfile error] Invalid size line : " + filepath);
+	}
+	if (info.is_array) {
+		// Only the lower triangle is stored for the matrices other than general ones
+		if (info.matrix_type == general_matrix) {
+			info.num_elements = info.m * info.n;
+		} else if (info.matrix_type == skew_symmetric_matrix) {
+			info.num_elements = info.n * (info.n - std::min<std::size_t>(info.n, 1)) / 2;
+		} else {
+			info.num_elements = info.n * (info.n + 1) / 2;
+		}
+	}
+	info.entries = std::min(size_line_end + 1, end);
+	return info;
+}
+
+// Split [begin, end) into `num_parts` ranges at line boundaries
+inline std::vector<const char*> split_lines(
+		const char* const begin,
+		const char* const end,
+		const std::size_t num_parts
+		) {
+	std::vector<const char*> bounds(num_parts + 1);
+	bounds[0] = begin;
+	for (std::size_t i = 1; i < num_parts; i++) {
+		const auto p = std::max(begin + (end - begin) * i / num_parts, bounds[i - 1]);
+		bounds[i] = p == begin ? p : std::min(find_line_end(p - 1, end) + 1, end);
+	}
+	bounds[num_parts] = end;
+	return bounds;
+}
+
+inline unsigned get_num_threads(
+		const unsigned num_threads
+		) {
+	if (num_threads != 0) {
+		return num_threads;
+	}
+#ifdef _OPENMP
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+inline bool is_blank_line(
+		const char* const p,
+		const char* const line_end
+		) {
+	const auto q = skip_spaces(p, line_end);
+	return q == line_end || *q == '%';
+}
+
+// Parse the coordinate entries in [begin, end) calling `func(i, j, v)` with 0-based indices.
+// The return value is the number of entries, or -1 when the text is malformed or `func` returns false.
+template <class V, bool HAS_VALUE, class Func>
+inline std::int64_t parse_coordinate_entries(
+		const char* const begin,
+		const char* const end,
+		Func& func
+		) {
+	std::int64_t num_entries = 0;
+	for (const char* p = begin; p < end;) {
+		const auto line_end = find_line_end(p, end);
+		if (is_blank_line(p, line_end)) {
+			p = line_end + 1;
+			continue;
+		}
+
+		std::size_t i, j;
+		V v = 1;
+		const char* r = p;
+		if (
+			(r = parse_uint(r, line_end, i)) == nullptr ||
+			(r = parse_uint(r, line_end, j)) == nullptr ||
+			(HAS_VALUE && (r = parse_value(r, line_end, v)) == nullptr) ||
+			i == 0 || j == 0 ||
+			!func(i - 1, j - 1, v)
+			) {
+			return -1;
+		}
+		num_entries++;
+		p = line_end + 1;
+	}
+	return num_entries;
+}
+
+// Parse the array entries in [begin, end), whose first entry is the `first_entry`-th one of the file.
+// The values are stored column by column, and only the lower triangle is stored for the matrices other than general ones.
+template <class V, class Func>
+inline std::int64_t parse_array_entries(
+		const char* const begin,
+		const char* const end,
+		const file_info& info,
+		const std::size_t first_entry,
+		Func& func
+		) {
+	if (first_entry >= info.num_elements) {
+		return begin == end || is_blank_line(begin, find_line_end(begin, end)) ? 0 : -1;
+	}
+	// The row offset of the first stored element in each column
+	const std::size_t diag = info.matrix_type == general_matrix ? 0 : (info.matrix_type == skew_symmetric_matrix ? 1 : 0);
+	std::size_t i, j;
+	if (info.matrix_type == general_matrix) {
+		i = first_entry % info.m;
+		j = first_entry / info.m;
+	} else {
+		auto k = first_entry;
+		for (j = 0; k >= info.m - j - diag; j++) {
+			k -= info.m - j - diag;
+		}
+		i = j + diag + k;
+	}
+
+	std::int64_t num_entries = 0;
+	for (const char* p = begin; p < end;) {
+		const auto line_end = find_line_end(p, end);
+		if (is_blank_line(p, line_end)) {
+			p = line_end + 1;
+			continue;
+		}
+
+		V v;
+		if (
+			j >= info.n ||
+			parse_value(p, line_end, v) == nullptr ||
+			!func(i, j, v)
+			) {
+			return -1;
+		}
+		num_entries++;
+		if (++i == info.m) {
+			j++;
+			i = info.matrix_type == general_matrix ? 0 : j + diag;
+		}
+		p = line_end + 1;
+	}
+	return num_entries;
+}
+
+inline std::size_t count_entries(
+		const char* const begin,
+		const char* const end
+		) {
+	std::size_t num_entries = 0;
+	for (const char* p = begin; p < end;) {
+		const auto line_end = find_line_end(p, end);
+		num_entries += !is_blank_line(p, line_end);
+		p = line_end + 1;
+	}
+	return num_entries;
+}
+
+// Parse all entries with `num_threads` threads calling `func(t, i, j, v)` in the thread `t`.
+// `v` is double for real and pattern matrices, std::int64_t for integer matrices and std::complex<double> for complex matrices.
+// The entries of each thread are in the file order, and the threads cover the file in order.
+template <class Func>
+inline void parse_entries(
+		const file_info& info,
+		const char* const end,
+		const unsigned num_threads,
+		const std::string filepath,
+		Func func
+		) {
+	if (info.matrix_type == unsupported_matrix || info.element_type == unsupported_value || (info.is_array && info.element_type == pattern_value)) {
+		throw std::runtime_error("[matfile error] Unsupported matrix : " + filepath);
+	}
+	if (info.matrix_type != general_matrix && info.m != info.n) {
+		throw std::runtime_error("[matfile error] A non-general matrix must be square : " + filepath);
+	}
+
+	const auto bounds = split_lines(info.entries, end, num_threads);
+
+	// The array format has no indices, so each thread needs the position of its first entry
+	std::vector<std::size_t> first_entries(num_threads + 1, 0);
+	if (info.is_array) {
+MATFILE_OMP(omp parallel for num_threads(num_threads))
+		for (std::int64_t t = 0; t < static_cast<std::int64_t>(num_threads); t++) {
+			first_entries[t + 1] = count_entries(bounds[t], bounds[t + 1]);
+		}
+		for (unsigned t = 0; t < num_threads; t++) {
+			first_entries[t + 1] += first_entries[t];
+		}
+	}
+
+	std::int64_t num_entries = 0;
+	bool succeeded = true;
+MATFILE_OMP(omp parallel for num_threads(num_threads) reduction(+: num_entries))
+	for (std::int64_t t = 0; t < static_cast<std::int64_t>(num_threads); t++) {
+		auto f = [&](const std::size_t i, const std::size_t j, const auto v) {
+			return i < info.m && j < info.n && func(t, i, j, v);
+		};
+		std::int64_t s;
+		if (info.is_array) {
+			if (info.element_type == integer_value) {
+				s = parse_array_entries<std::int64_t>(bounds[t], bounds[t + 1], info, first_entries[t], f);
+			} else if (info.element_type == complex_value) {
+				s = parse_array_entries<std::complex<double>>(bounds[t], bounds[t + 1], info, first_entries[t], f);
+			} else {
+				s = parse_array_entries<double>(bounds[t], bounds[t + 1], info, first_entries[t], f);
+			}
+		} else {
+			if (info.element_type == integer_value) {
+				s = parse_coordinate_entries<std::int64_t, true>(bounds[t], bounds[t + 1], f);
+			} else if (info.element_type == complex_value) {
+				s = parse_coordinate_entries<std::complex<double>, true>(bounds[t], bounds[t + 1], f);
+			} else if (info.element_type == pattern_value) {
+				s = parse_coordinate_entries<double, false>(bounds[t], bounds[t + 1], f);
+			} else {
+				s = parse_coordinate_entries<double, true>(bounds[t], bounds[t + 1], f);
+			}
+		}
+		if (s < 0) {
+MATFILE_OMP(omp atomic write)
+			succeeded = false;
+		} else {
+			num_entries += s;
+		}
+	}
+	if (!succeeded || num_entries < static_cast<std::int64_t>(info.num_elements)) {
+		throw std::runtime_error("[matfile error] Invalid entries : " + filepath);
+	}
+}
+
+template <class T>
+inline void check_value_type(
+		const file_info& info,
+		const std::string filepath
+		) {
+	if (info.element_type == complex_value && !is_complex<T>::value) {
+		throw std::runtime_error("[matfile error] A complex matrix cannot be loaded as a real type : " + filepath);
+	}
+}
+} // unnamed namespace
+
+template <class INT_T>
+void load_matrix_size(
+		INT_T& m,
+		INT_T& n,
+		const std::string filepath
+		) {
+	std::ifstream ifs(filepath);
+
+	if (!ifs) {
+		throw std::runtime_error("[matfile error] No such file : " + filepath);
+	}
+
+	std::string line;
+	while (std::getline(ifs, line)) {
+		if (line[0] != '%') {
+			break;
+		}
+	}
+	std::size_t num_elements;
+
+	std::stringstream ss(line);
+	ss >> m >> n >> num_elements;
+
+	ifs.close();
+}
+
+template <class INT_T = std::size_t>
+std::pair<INT_T, INT_T> load_matrix_size(
+		const std::string filepath
+		) {
+	std::size_t m, n;
+	load_matrix_size(m, n, filepath);
+
+	return std::pair<INT_T, INT_T>{m, n};
+}
+
+// Load a matrix into the dense column major `ptr`.
+// When a coordinate appears more than once, the last entry in the file wins regardless of `num_threads`.
+template <class T>
+void load_matrix(
+		T* const ptr,
+		const std::size_t ld,
+		const std::string filepath,
+		const bool fill_zero = true,
+		const unsigned num_threads = 0
+		) {
+	const detail::mapped_file file(filepath);
+	const auto info = detail::parse_file_info(file.begin(), file.end(), filepath);
+	const auto line = std::string(file.begin(), detail::find_line_end(file.begin(), file.end()));
+
+	const auto matrix_type = info.matrix_type;
+	if (matrix_type == detail::unsupported_matrix) {
+		throw std::runtime_error("Unsupported matrix type : banner = " + line);
+	}
+	const auto element_type = info.element_type;
+	if (element_type == detail::unsupported_value) {
+		throw std::runtime_error("Unsupported element type : banner = " + line);
+	}
+	detail::check_value_type<T>(info, filepath);
+
+	const std::size_t m = info.m;
+	const std::size_t n = info.n;
+	// The owners of the elements below are stored in 16 bits
+	const auto nt = std::min(detail::get_num_threads(num_threads), 65535u);
+
+	if (fill_zero) {
+MATFILE_OMP(omp parallel for num_threads(nt))
+		for (std::int64_t j = 0; j < static_cast<std::int64_t>(n); j++) {
+			for (std::size_t i = 0; i < m; i++) {
+				ptr[i + j * ld] = 0;
+			}
+		}
+	}
+
+	// Duplicate coordinates may be parsed by different threads, which cover the file in order.
+	// `owners` holds the largest (thread + 1) which has reached each element, and the entries of earlier threads are dropped.
+	// Only the first entry of an element is written directly. The later ones are replayed in thread order at the end.
+	const bool track_owners = !info.is_array && nt > 1;
+	std::unique_ptr<std::atomic<std::uint16_t>[]> owners(track_owners ? new std::atomic<std::uint16_t>[m * n]() : nullptr);
+	std::vector<std::vector<std::pair<std::size_t, T>>> replays(track_owners ? nt : 0);
+	const auto write = [&](const unsigned t, const std::size_t i, const std::size_t j, const T v) {
+		if (track_owners) {
+			const std::uint16_t self = t + 1;
+			auto& owner = owners[i + j * m];
+			auto prev = owner.load(std::memory_order_relaxed);
+			while (prev < self && !owner.compare_exchange_weak(prev, self, std::memory_order_relaxed)) {}
+			if (prev > self) {
+				return;
+			}
+			if (prev != 0) {
+				replays[t].emplace_back(i + j * ld, v);
+				return;
+			}
+		}
+		ptr[i + j * ld] = v;
+	};
+
+	// Each thread parses the lines in its own part of the entry section
+	detail::parse_entries(info, file.end(), nt, filepath,
+		[&](const unsigned t, const std::size_t i, const std::size_t j, const auto v) {
+			write(t, i, j, detail::cast_value<T>(v));
+			if (matrix_type != detail::general_matrix && i != j) {
+				write(t, j, i, detail::cast_value<T>(detail::get_mirrored_value(v, matrix_type)));
+			}
+			return true;
+		});
+	for (const auto& replay : replays) {
+		for (const auto& [index, v] : replay) {
+			ptr[index] = v;
+		}
+	}
+}
+
+// Load the entries as COO without allocating the dense matrix.
+// Symmetric, skew-symmetric and hermitian matrices are expanded to both triangles when `expand_symmetric` is true.
+// When `sort_and_sum` is true, the entries are sorted by (row, column) and duplicates are summed.
+template <class T, class INDEX_T = std::uint64_t>
+coo_matrix<T, INDEX_T> load_coo(
+		const std::string filepath,
+		const bool expand_symmetric = true,
+		const bool sort_and_sum = false,
+		const unsigned num_threads = 0
+		) {
+	const detail::mapped_file file(filepath);
+	const auto info = detail::parse_file_info(file.begin(), file.end(), filepath);
+	detail::check_value_type<T>(info, filepath);
+	const auto mirror = expand_symmetric && info.matrix_type != detail::general_matrix;
+	const auto nt = detail::get_num_threads(num_threads);
+
+	// Each thread parses its part into its own COO, and they are concatenated in order
+	std::vector<coo_matrix<T, INDEX_T>> parts(nt);
+	detail::parse_entries(info, file.end(), nt, filepath,
+		[&](const unsigned t, const std::size_t i, const std::size_t j, const auto v) {
+			auto& part = parts[t];
+			part.row_index.push_back(i);
+			part.col_index.push_back(j);
+			part.values.push_back(detail::cast_value<T>(v));
+			if (mirror && i != j) {
+				part.row_index.push_back(j);
+				part.col_index.push_back(i);
+				part.values.push_back(detail::cast_value<T>(detail::get_mirrored_value(v, info.matrix_type)));
+			}
+			return true;
+		});
+
+	std::vector<std::size_t> offsets(nt + 1, 0);
+	for (unsigned t = 0; t < nt; t++) {
+		offsets[t + 1] = offsets[t] + parts[t].nnz();
+	}
+	coo_matrix<T, INDEX_T> coo;
+	coo.m = info.m;
+	coo.n = info.n;
+	coo.row_index.resize(offsets[nt]);
+	coo.col_index.resize(offsets[nt]);
+	coo.values.resize(offsets[nt]);
+MATFILE_OMP(omp parallel for num_threads(nt))
+	for (std::int64_t t = 0; t < static_cast<std::int64_t>(nt); t++) {
+		std::copy(parts[t].row_index.begin(), parts[t].row_index.end(), coo.row_index.begin() + offsets[t]);
+		std::copy(parts[t].col_index.begin(), parts[t].col_index.end(), coo.col_index.begin() + offsets[t]);
+		std::copy(parts[t].values.begin(), parts[t].values.end(), coo.values.begin() + offsets[t]);
+		parts[t] = coo_matrix<T, INDEX_T>{};
+	}
+
+	if (sort_and_sum) {
+		// Sorting through CSR is O(nnz) except for the sorts in each row
+		const auto csr = to_csr(coo, true);
+		coo.row_index.resize(csr.nnz());
+		for (std::size_t i = 0; i < csr.m; i++) {
+			std::fill(coo.row_index.begin() + csr.row_ptr[i], coo.row_index.begin() + csr.row_ptr[i + 1], i);
+		}
+		coo.col_index = csr.col_index;
+		coo.values = csr.values;
+	}
+	return coo;
+}
+
+// Load the entries as CSR. Columns are sorted in each row and duplicates are summed when `sort_and_sum` is true.
+template <class T, class INDEX_T = std::uint64_t>
+csr_matrix<T, INDEX_T> load_csr(
+		const std::string filepath,
+		const bool expand_symmetric = true,
+		const bool sort_and_sum = true,
+		const unsigned num_threads = 0
+		) {
+	return to_csr(load_coo<T, INDEX_T>(filepath, expand_symmetric, false, num_threads), sort_and_sum);
+}
+
+// Load the entries as CSC. Rows are sorted in each column and duplicates are summed when `sort_and_sum` is true.
+template <class T, class INDEX_T = std::uint64_t>
+csc_matrix<T, INDEX_T> load_csc(
+		const std::string filepath,
+		const bool expand_symmetric = true,
+		const bool sort_and_sum = true,
+		const unsigned num_threads = 0
+		) {
+	return to_csc(load_coo<T, INDEX_T>(filepath, expand_symmetric, false, num_threads), sort_and_sum);
+}
+
+namespace detail {
+// Upper bound of the length of a formatted entry (two 20-digit indices and a real or complex value)
+constexpr std::size_t max_line_length = 128;
+// Number of entries formatted by a thread at once
+constexpr std::size_t write_block_size = 1lu << 16;
+
+template <class T>
+inline char* format_value(
+		char* const p,
+		char* const end,
+		const T v
+		) {
+	if constexpr (is_complex<T>::value) {
+		auto q = std::to_chars(p, end, v.real()).ptr;
+		*(q++) = ' ';
+		return std::to_chars(q, end, v.imag()).ptr;
+	} else if constexpr (std::is_floating_point<T>::value) {
+		return std::to_chars(p, end, v).ptr;
+	} else if constexpr (mtk::matfile::detail::is_16bit_float<T>::value) {
+		return std::to_chars(p, end, static_cast<float>(v)).ptr;
+	} else if constexpr (std::is_signed<T>::value) {
+		return std::to_chars(p, end, static_cast<long long>(v)).ptr;
+	} else {
+		return std::to_chars(p, end, static_cast<unsigned long long>(v)).ptr;
+	}
+}
+
+inline char* format_index(
+		char* const p,
+		char* const end,
+		const std::uint64_t i
+		) {
+	return std::to_chars(p, end, i + 1).ptr;
+}
+
+// "%%MatrixMarket matrix <format> <field> general" where the field is determined by T
+template <class T>
+inline std::string get_banner(
+		const std::string format
+		) {
+	const std::string field = is_complex<T>::value ? "complex" : (std::is_integral<T>::value ? "integer" : "real");
+	return "%%MatrixMarket matrix " + format + " " + field + " general";
+}
+
+// Write a file with `num_entries` entries.
+// `format_entries(k0, k1, p, end)` formats the entries [k0, k1) into [p, end) and returns the end of the text.
+// Each thread formats its own block into its own buffer, and the blocks are written in order.
+template <class Func>
+void write_entries(
+		const std::string filepath,
+		const std::string banner,
+		const std::string size_line,
+		const std::uint64_t num_entries,
+		const unsigned num_threads,
+		Func format_entries
+		) {
+	const int fd = open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		throw std::runtime_error("[matfile error] Failed to open : " + filepath);
+	}
+	const auto head = banner + "\n" + size_line + "\n";
+	bool succeeded = mtk::matfile::detail::pwrite_all(fd, head.data(), head.size(), 0);
+	std::size_t offset = head.size();
+
+	const auto nt = get_num_threads(num_threads);
+	std::vector<std::unique_ptr<char[]>> buffers(nt);
+	std::vector<std::size_t> lengths(nt);
+	for (std::uint64_t k = 0; k < num_entries && succeeded; k += nt * write_block_size) {
+MATFILE_OMP(omp parallel for num_threads(nt))
+		for (std::int64_t t = 0; t < static_cast<std::int64_t>(nt); t++) {
+			const auto k0 = std::min<std::uint64_t>(k + t * write_block_size, num_entries);
+			const auto k1 = std::min<std::uint64_t>(k0 + write_block_size, num_entries);
+			if (!buffers[t]) {
+				buffers[t].reset(new char[write_block_size * max_line_length]);
+			}
+			const auto p = buffers[t].get();
+			lengths[t] = format_entries(k0, k1, p, p + write_block_size * max_line_length) - p;
+		}
+		for (unsigned t = 0; t < nt; t++) {
+			succeeded = succeeded && mtk::matfile::detail::pwrite_all(fd, buffers[t].get(), lengths[t], offset);
+			offset += lengths[t];
+		}
+	}
+	close(fd);
+	if (!succeeded) {
+		throw std::runtime_error("[matfile error] Failed to write : " + filepath);
+	}
+}
+
+// Format the entry (i, j, v) as "i+1 j+1 v\n"
+template <class T>
+inline char* format_entry(
+		char* p,
+		char* const end,
+		const std::uint64_t i,
+		const std::uint64_t j,
+		const T v
+		) {
+	p = format_index(p, end, i); *(p++) = ' ';
+	p = format_index(p, end, j); *(p++) = ' ';
+	p = format_value(p, end, v); *(p++) = '\n';
+	return p;
+}
+
+template <class T, class INDEX_T>
+void save_compressed(
+		const std::uint64_t m,
+		const std::uint64_t n,
+		const std::uint64_t num_major,
+		const INDEX_T* const ptr,
+		const INDEX_T* const index,
+		const T* const values,
+		const bool row_major,
+		const std::string filepath,
+		const unsigned num_threads
+		) {
+	const std::uint64_t nnz = ptr[num_major];
+	write_entries(filepath, get_banner<T>("coordinate"), std::to_string(m) + " " + std::to_string(n) + " " + std::to_string(nnz), nnz, num_threads,
+		[&](const std::uint64_t k0, const std::uint64_t k1, char* p, char* const end) {
+			// The major index of the entry k0
+			std::uint64_t major = std::upper_bound(ptr, ptr + num_major + 1, static_cast<INDEX_T>(k0)) - ptr - 1;
+			for (auto k = k0; k < k1; k++) {
+				while (ptr[major + 1] <= k) {
+					major++;
+				}
+				p = row_major ? format_entry(p, end, major, index[k], values[k]) : format_entry(p, end, index[k], major, values[k]);
+			}
+			return p;
+		});
+}
+} // namespace detail
+
+// Save the dense matrix in the array format
+template <class T>
+void save_matrix(
+		const std::uint64_t m,
+		const std::uint64_t n,
+		const T* const ptr,
+		const std::uint64_t ld,
+		const std::string filepath,
+		const unsigned num_threads = 0
+		) {
+	detail::write_entries(filepath, detail::get_banner<T>("array"), std::to_string(m) + " " + std::to_string(n), m * n, num_threads,
+		[&](const std::uint64_t k0, const std::uint64_t k1, char* p, char* const end) {
+			for (auto k = k0; k < k1; k++) {
+				p = detail::format_value(p, end, ptr[k % m + k / m * ld]);
+				*(p++) = '\n';
+			}
+			return p;
+		});
+}
+
+template <class T, class INDEX_T>
+void save_coo(
+		const coo_matrix<T, INDEX_T>& mat,
+		const std::string filepath,
+		const unsigned num_threads = 0
+		) {
+	detail::write_entries(filepath, detail::get_banner<T>("coordinate"), std::to_string(mat.m) + " " + std::to_string(mat.n) + " " + std::to_string(mat.nnz()), mat.nnz(), num_threads,
+		[&](const std::uint64_t k0, const std::uint64_t k1, char* p, char* const end) {
+			for (auto k = k0; k < k1; k++) {
+				p = detail::format_entry(p, end, mat.row_index[k], mat.col_index[k], mat.values[k]);
+			}
+			return p;
+		});
+}
+
+template <class T, class INDEX_T>
+void save_csr(
+		const csr_matrix<T, INDEX_T>& mat,
+		const std::string filepath,
+		const unsigned num_threads = 0
+		) {
+	detail::save_compressed(mat.m, mat.n, mat.m, mat.row_ptr.data(), mat.col_index.data(), mat.values.data(), true, filepath, num_threads);
+}
+
+template <class T, class INDEX_T>
+void save_csc(
+		const csc_matrix<T, INDEX_T>& mat,
+		const std::string filepath,
+		const unsigned num_threads = 0
+		) {
+	detail::save_compressed(mat.m, mat.n, mat.n, mat.col_ptr.data(), mat.row_index.data(), mat.values.data(), false, filepath, num_threads);
 }
 } // namespace matrix_market
 template <class T>
@@ -1,85 +1,590 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/numpy.h>
+#include <pybind11/stl.h>
 #include <matfile/matfile.hpp>
 #include <cstdint>
 #include <variant>
 #include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <functional>
 
+// mtk::matfile::half is numpy.float16
+namespace pybind11 {
+template <>
+struct format_descriptor<mtk::matfile::half> {
+	static std::string format() {return "e";}
+};
+namespace detail {
+template <>
+struct npy_format_descriptor<mtk::matfile::half> {
+	static constexpr auto name = const_name("float16");
+	static pybind11::dtype dtype() {return pybind11::dtype("e");}
+};
+} // namespace detail
+} // namespace pybind11
+
+// numpy has no bfloat16, so bfloat16 files are loaded as float32
 template <class T>
-void save_dense(
-	pybind11::array_t<T> mat,
-	const std::string file_name
+struct python_type {using type = T;};
+template <>
+struct python_type<mtk::matfile::bfloat16> {using type = float;};
+
+// Run `func(i)` for i in [0, n) on `num_threads` threads.
+// The first exception thrown by `func` is rethrown after all threads finish.
+template <class Func>
+void parallel_for(
+	const std::size_t n,
+	const unsigned num_threads,
+	Func func
 	) {
-	pybind11::buffer_info buf = mat.request();
+	std::atomic<std::size_t> next(0);
+	std::exception_ptr error;
+	std::mutex error_mutex;
+	auto worker = [&]() {
+		for (std::size_t i; (i = next++) < n;) {
+			try {
+				func(i);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+		}
+	};
 
-	std::size_t m, n;
+	const auto nt = std::min<std::size_t>(n, num_threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : num_threads);
+	std::vector<std::thread> threads;
+	for (std::size_t t = 1; t < nt; t++) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& t : threads) {
+		t.join();
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+// Call `func(type_tag<T>{})` with the element type T of `array`. Returns false when the type is not supported.
+template <class T, class Func>
+bool dispatch_array_type_core(
+	const pybind11::handle& array,
+	Func& func
+	) {
+	if (!pybind11::isinstance<pybind11::array_t<T>>(array)) {
+		return false;
+	}
+	func(mtk::matfile::detail::type_tag<T>{});
+	return true;
+}
+
+template <class Func>
+bool dispatch_array_type(
+	const pybind11::handle& array,
+	Func func
+	) {
+	return
+		dispatch_array_type_core<float        >(array, func) ||
+		dispatch_array_type_core<double       >(array, func) ||
+		dispatch_array_type_core<long double  >(array, func) ||
+		dispatch_array_type_core<std::int8_t  >(array, func) ||
+		dispatch_array_type_core<std::int16_t >(array, func) ||
+		dispatch_array_type_core<std::int32_t >(array, func) ||
+		dispatch_array_type_core<std::int64_t >(array, func) ||
+		dispatch_array_type_core<std::uint8_t >(array, func) ||
+		dispatch_array_type_core<std::uint16_t>(array, func) ||
+		dispatch_array_type_core<std::uint32_t>(array, func) ||
+		dispatch_array_type_core<std::uint64_t>(array, func) ||
+		dispatch_array_type_core<mtk::matfile::half>(array, func);
+}
+
+// Matrix in a numpy buffer. The strides are in bytes and can be arbitrary.
+template <class T>
+struct dense_view {
+	const T* ptr;
+	std::size_t m;
+	std::size_t n;
+	std::int64_t row_stride;
+	std::int64_t col_stride;
+
+	const T& operator()(const std::size_t i, const std::size_t j) const {
+		return *reinterpret_cast<const T*>(reinterpret_cast<const char*>(ptr) + static_cast<std::int64_t>(i) * row_stride + static_cast<std::int64_t>(j) * col_stride);
+	}
+};
+
+template <class T>
+dense_view<T> get_dense_view(
+	const pybind11::buffer_info& buf
+	) {
+	dense_view<T> view{static_cast<const T*>(buf.ptr), 0, 0, 0, 0};
 	if (buf.ndim == 1) {
-		m = buf.shape[0];
-		n = 1;
+		view.m = buf.shape[0];
+		view.n = 1;
+		view.row_stride = buf.strides[0];
 	} else if (buf.ndim == 2){
-		m = buf.shape[0];
-		n = buf.shape[1];
+		view.m = buf.shape[0];
+		view.n = buf.shape[1];
+		view.row_stride = buf.strides[0];
+		view.col_stride = buf.strides[1];
 	} else {
 		throw std::runtime_error("ndim must be smaller than 3 but " + std::to_string(buf.ndim) + "is given.");
 	}
-	mtk::matfile::save_dense<T>(
-		m, n, static_cast<T*>(buf.ptr), n, file_name, mtk::matfile::op_t::transpose
-		);
+	// The stride of a dimension of size 1 is meaningless
+	if (view.m <= 1) {
+		view.row_stride = sizeof(T);
+	}
+	if (view.n <= 1) {
+		view.col_stride = view.m * sizeof(T);
+	}
+	return view;
 }
 
-template <class T>
-using array_t = pybind11::array_t<T, pybind11::array::f_style | pybind11::array::forcecast>;
+// Called without the GIL
+template <class T, class MATFILE_T>
+void save_dense_view(
+	const dense_view<T>& view,
+	const std::string file_name
+	) {
+	const std::int64_t elem_size = sizeof(T);
+	const auto m = view.m;
+	const auto n = view.n;
+	if (view.row_stride == elem_size && view.col_stride % elem_size == 0 && view.col_stride / elem_size >= static_cast<std::int64_t>(m)) {
+		// Column major (e.g. Fortran order). Written as it is.
+		mtk::matfile::save_dense<T, MATFILE_T>(
+			m, n, view.ptr, view.col_stride / elem_size, file_name, mtk::matfile::op_t::no_transpose
+			);
+	} else if (view.col_stride == elem_size && view.row_stride % elem_size == 0 && view.row_stride / elem_size >= static_cast<std::int64_t>(n)) {
+		// Row major (e.g. C order). Transposed by blocks in the library.
+		mtk::matfile::save_dense<T, MATFILE_T>(
+			m, n, view.ptr, view.row_stride / elem_size, file_name, mtk::matfile::op_t::transpose
+			);
+	} else {
+		// Arbitrary strides. Gathered and written by column panels.
+		const auto panel_width = std::max<std::size_t>(1, (1lu << 23) / std::max<std::size_t>(1, m * sizeof(T)));
+		std::unique_ptr<T[]> panel(new T[m * std::min(panel_width, n)]);
+		mtk::matfile::dense_writer<T, MATFILE_T> writer(m, n, file_name);
+		for (std::size_t j0 = 0; j0 < n; j0 += panel_width) {
+			const auto cols = std::min(panel_width, n - j0);
+			for (std::size_t j = 0; j < cols; j++) {
+				for (std::size_t i = 0; i < m; i++) {
+					panel[i + j * m] = view(i, j0 + j);
+				}
+			}
+			writer.append_columns(panel.get(), m, cols, mtk::matfile::op_t::no_transpose);
+		}
+		writer.close();
+	}
+}
 
-template <class T>
-array_t<T> load_dense_core(const std::string filename) {
-  std::size_t m, n;
-  mtk::matfile::load_matrix_size(m, n, filename);
-	T* ptr = new T[m * n];
-	mtk::matfile::load_dense(ptr, m, filename);
+// Returns the function saving `mat` as the element type of `dtype` (the same type as `mat` if None).
+// bfloat16, which numpy does not have, is selected by the name "bfloat16".
+inline std::function<void()> make_save_task(
+	const pybind11::array& mat,
+	const std::string file_name,
+	const pybind11::object& dtype
+	) {
+	const auto bf16 = pybind11::isinstance<pybind11::str>(dtype) && dtype.cast<std::string>() == "bfloat16";
+	const auto file_dtype = (dtype.is_none() || bf16) ? mat.dtype() : pybind11::dtype::from_args(dtype);
+	// Empty array of the file type for the dispatch
+	const pybind11::array file_type_array(file_dtype, std::vector<pybind11::ssize_t>{0});
 
-	pybind11::capsule destroy(ptr, [](void *f) {
-		T *p = reinterpret_cast<T*>(f);
-		delete [] p;
+	std::function<void()> task;
+	const auto supported = dispatch_array_type(mat, [&](const auto tag) {
+		using T = typename decltype(tag)::type;
+		const auto view = get_dense_view<T>(mat.request());
+		if (bf16) {
+			task = [view, file_name]() {save_dense_view<T, mtk::matfile::bfloat16>(view, file_name);};
+			return;
+		}
+		dispatch_array_type(file_type_array, [&](const auto file_tag) {
+			using MATFILE_T = typename decltype(file_tag)::type;
+			task = [view, file_name]() {save_dense_view<T, MATFILE_T>(view, file_name);};
+		});
 	});
+	if (!supported || !task) {
+		throw std::runtime_error("Unsupported dtype : " + file_name);
+	}
+	return task;
+}
+
+void save_dense(
+	const pybind11::array mat,
+	const std::string file_name,
+	const pybind11::object dtype
+	) {
+	const auto task = make_save_task(mat, file_name, dtype);
 
+	pybind11::gil_scoped_release release;
+	task();
+}
+
+template <class T>
+using array_t = pybind11::array_t<T, pybind11::array::f_style | pybind11::array::forcecast>;
+
+template <class T>
+array_t<T> make_array(
+	T* const ptr,
+	const std::size_t m,
+	const std::size_t n,
+	pybind11::capsule base
+	) {
 	if (n == 1) {
 		return array_t<T>(
 			{m},
 			{sizeof(T)},
 			ptr,
-			destroy
+			base
 			);
 	} else {
 		return array_t<T>(
 			{m, n},
 			{sizeof(T), m * sizeof(T)},
 			ptr,
-			destroy
+			base
 			);
 	}
 }
 
+// The buffer is owned by the returned array
+template <class T>
+array_t<T> wrap_buffer(
+	T* const ptr,
+	const std::size_t m,
+	const std::size_t n
+	) {
+	pybind11::capsule destroy(ptr, [](void *f) {
+		T *p = reinterpret_cast<T*>(f);
+		delete [] p;
+	});
+
+	return make_array(ptr, m, n, destroy);
+}
+
+template <class T>
+array_t<T> load_dense_core(const std::string filename) {
+	std::size_t m, n;
+	std::unique_ptr<T[]> ptr;
+	{
+		pybind11::gil_scoped_release release;
+		mtk::matfile::load_matrix_size(m, n, filename);
+		ptr.reset(new T[m * n]);
+		mtk::matfile::load_dense(ptr.get(), m, filename);
+	}
+
+	return wrap_buffer(ptr.release(), m, n);
+}
+
+// The array refers to the mapping of the file, which is kept alive by the capsule.
+// It is read-only since the file is mapped with PROT_READ.
+template <class T>
+array_t<T> load_dense_mmap_core(const std::string filename) {
+	auto mapped = new mtk::matfile::mapped_dense<T>(filename);
+
+	pybind11::capsule unmap(mapped, [](void *f) {
+		delete reinterpret_cast<mtk::matfile::mapped_dense<T>*>(f);
+	});
+
+	auto array = make_array(const_cast<T*>(mapped->data()), mapped->m(), mapped->n(), unmap);
+	array.attr("setflags")(pybind11::arg("write") = false);
+	return array;
+}
+
+template <class T>
+pybind11::object load_dense_typed(
+	const std::string filename,
+	const bool mmap
+	) {
+	if (mmap) {
+		return load_dense_mmap_core<T>(filename);
+	}
+	return load_dense_core<T>(filename);
+}
+
 pybind11::object load_dense(
-	const std::string filename
+	const std::string filename,
+	const bool mmap
 	) {
 	const auto info = mtk::matfile::load_header(filename);
   switch (info.data_type) {
-    case mtk::matfile::data_t::fp32  : return {load_dense_core<float        >(filename)};
-    case mtk::matfile::data_t::fp64  : return {load_dense_core<double       >(filename)};
-    case mtk::matfile::data_t::fp128 : return {load_dense_core<long double  >(filename)};
-    case mtk::matfile::data_t::int8  : return {load_dense_core<std::int8_t  >(filename)};
-    case mtk::matfile::data_t::int16 : return {load_dense_core<std::int16_t >(filename)};
-    case mtk::matfile::data_t::int32 : return {load_dense_core<std::int32_t >(filename)};
-    case mtk::matfile::data_t::int64 : return {load_dense_core<std::int64_t >(filename)};
-    case mtk::matfile::data_t::uint8 : return {load_dense_core<std::uint8_t >(filename)};
-    case mtk::matfile::data_t::uint16: return {load_dense_core<std::uint16_t>(filename)};
-    case mtk::matfile::data_t::uint32: return {load_dense_core<std::uint32_t>(filename)};
-    case mtk::matfile::data_t::uint64: return {load_dense_core<std::uint64_t>(filename)};
+    case mtk::matfile::data_t::fp32  : return load_dense_typed<float        >(filename, mmap);
+    case mtk::matfile::data_t::fp64  : return load_dense_typed<double       >(filename, mmap);
+    case mtk::matfile::data_t::fp128 : return load_dense_typed<long double  >(filename, mmap);
+    case mtk::matfile::data_t::int8  : return load_dense_typed<std::int8_t  >(filename, mmap);
+    case mtk::matfile::data_t::int16 : return load_dense_typed<std::int16_t >(filename, mmap);
+    case mtk::matfile::data_t::int32 : return load_dense_typed<std::int32_t >(filename, mmap);
+    case mtk::matfile::data_t::int64 : return load_dense_typed<std::int64_t >(filename, mmap);
+    case mtk::matfile::data_t::uint8 : return load_dense_typed<std::uint8_t >(filename, mmap);
+    case mtk::matfile::data_t::uint16: return load_dense_typed<std::uint16_t>(filename, mmap);
+    case mtk::matfile::data_t::uint32: return load_dense_typed<std::uint32_t>(filename, mmap);
+    case mtk::matfile::data_t::uint64: return load_dense_typed<std::uint64_t>(filename, mmap);
+    case mtk::matfile::data_t::fp16  : return load_dense_typed<mtk::matfile::half>(filename, mmap);
+    case mtk::matfile::data_t::bf16  :
+      if (mmap) {
+        throw std::runtime_error("bfloat16 files can not be mapped since numpy does not support bfloat16 : " + filename);
+      }
+      return load_dense_typed<float>(filename, false);
     default: break;
   }
   return array_t<float>{};
 }
 
+// Load the files concurrently on `threads` threads without the GIL
+pybind11::list load_many(
+	const std::vector<std::string> filenames,
+	const unsigned threads
+	) {
+	struct job_t {
+		mtk::matfile::detail::file_header header;
+		void* ptr = nullptr;
+	};
+	std::vector<job_t> jobs(filenames.size());
+	const auto free_buffers = [&]() {
+		for (auto& job : jobs) {
+			if (job.ptr != nullptr) {
+				mtk::matfile::detail::dispatch_data_type(job.header.data_type, [&](const auto tag) {
+					using T = typename python_type<typename decltype(tag)::type>::type;
+					delete [] reinterpret_cast<T*>(job.ptr);
+				});
+			}
+		}
+	};
+
+	try {
+		pybind11::gil_scoped_release release;
+		parallel_for(filenames.size(), threads, [&](const std::size_t i) {
+			auto& job = jobs[i];
+			job.header = mtk::matfile::load_header(filenames[i]);
+			mtk::matfile::detail::dispatch_data_type(job.header.data_type, [&](const auto tag) {
+				using T = typename python_type<typename decltype(tag)::type>::type;
+				const auto ptr = new T[job.header.m * job.header.n];
+				job.ptr = ptr;
+				mtk::matfile::load_dense(ptr, job.header.m, filenames[i]);
+			});
+		});
+	} catch (...) {
+		free_buffers();
+		throw;
+	}
+
+	pybind11::list arrays;
+	for (auto& job : jobs) {
+		mtk::matfile::detail::dispatch_data_type(job.header.data_type, [&](const auto tag) {
+			using T = typename python_type<typename decltype(tag)::type>::type;
+			arrays.append(wrap_buffer(reinterpret_cast<T*>(job.ptr), job.header.m, job.header.n));
+		});
+		job.ptr = nullptr;
+	}
+	return arrays;
+}
+
+// Save the arrays concurrently on `threads` threads without the GIL
+void save_many(
+	const std::vector<pybind11::object> matrices,
+	const std::vector<std::string> file_names,
+	const unsigned threads,
+	const pybind11::object dtype
+	) {
+	if (matrices.size() != file_names.size()) {
+		throw std::runtime_error("The numbers of matrices and file names are mismatch");
+	}
+
+	// The arrays are kept alive until all tasks finish
+	std::vector<pybind11::array> arrays;
+	std::vector<std::function<void()>> tasks;
+	for (std::size_t i = 0; i < matrices.size(); i++) {
+		arrays.push_back(pybind11::array::ensure(matrices[i]));
+		if (!arrays.back()) {
+			throw std::runtime_error("Unsupported matrix type : " + file_names[i]);
+		}
+		tasks.push_back(make_save_task(arrays.back(), file_names[i], dtype));
+	}
+
+	pybind11::gil_scoped_release release;
+	parallel_for(tasks.size(), threads, [&](const std::size_t i) {tasks[i]();});
+}
+
+// Indices selected by an integer or a slice along a dimension of `length`
+struct index_range {
+	std::int64_t start;
+	std::int64_t step;
+	std::int64_t length;
+	// Whether the dimension is removed from the result (integer key)
+	bool drop;
+
+	std::int64_t operator[](const std::int64_t k) const {return start + k * step;}
+	std::int64_t min() const {return step > 0 ? start : (*this)[length - 1];}
+	std::int64_t max() const {return step > 0 ? (*this)[length - 1] : start;}
+};
+
+inline index_range get_index_range(
+	const pybind11::handle key,
+	const std::int64_t length
+	) {
+	if (pybind11::isinstance<pybind11::slice>(key)) {
+		pybind11::ssize_t start, stop, step, slice_length;
+		if (!pybind11::reinterpret_borrow<pybind11::slice>(key).compute(length, &start, &stop, &step, &slice_length)) {
+			throw pybind11::error_already_set();
+		}
+		return index_range{start, step, slice_length, false};
+	}
+	auto i = key.cast<std::int64_t>();
+	if (i < 0) {
+		i += length;
+	}
+	if (i < 0 || i >= length) {
+		throw pybind11::index_error("index " + std::to_string(key.cast<std::int64_t>()) + " is out of bounds for axis with size " + std::to_string(length));
+	}
+	return index_range{i, 1, 1, true};
+}
+
+// Dense matfile opened for random access. Only the requested blocks are read.
+class matfile_object {
+	const std::string file_name;
+	mtk::matfile::detail::file_header header;
+
+	// Called without the GIL
+	template <class T>
+	void read(
+		T* const dst,
+		const index_range& rows,
+		const index_range& cols
+		) const {
+		// The bounding rows of the selected columns are read by panels
+		const auto row0 = rows.min();
+		const auto num_rows = rows.max() - row0 + 1;
+		const std::int64_t panel_width = std::max<std::int64_t>(1, (1l << 23) / (num_rows * sizeof(T)));
+		std::unique_ptr<T[]> buffer(new T[num_rows * std::min(panel_width, cols.length)]);
+
+		// Strided columns are read chunk by chunk so that each chunk is decoded once
+		const std::int64_t chunk_cols = mtk::matfile::detail::is_chunked(header) ? std::max<std::int64_t>(1, header.a1) : 1;
+		std::unique_ptr<T[]> span_buffer(cols.step != 1 && chunk_cols > 1 ? new T[num_rows * chunk_cols] : nullptr);
+
+		const int fd = open(file_name.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("[matfile error] No such file : " + file_name);
+		}
+		auto status = mtk::matfile::detail::read_status::ok;
+		const auto load = [&](T* const ptr, const std::int64_t col0, const std::int64_t num_cols) {
+			status = mtk::matfile::detail::load_dense_window(ptr, fd, header, row0, col0, num_rows, num_cols, num_rows, mtk::matfile::op_t::no_transpose, mtk::matfile::convert_t::cast, 1);
+		};
+		for (std::int64_t k0 = 0; k0 < cols.length && status == mtk::matfile::detail::read_status::ok; k0 += panel_width) {
+			const auto num_cols = std::min(panel_width, cols.length - k0);
+			if (cols.step == 1) {
+				load(buffer.get(), cols[k0], num_cols);
+			} else {
+				// The selected columns in a chunk are consecutive in k
+				for (std::int64_t k = 0; k < num_cols && status == mtk::matfile::detail::read_status::ok;) {
+					auto k_end = k + 1;
+					while (k_end < num_cols && cols[k0 + k_end] / chunk_cols == cols[k0 + k] / chunk_cols) {
+						k_end++;
+					}
+					if (k_end - k == 1) {
+						load(buffer.get() + k * num_rows, cols[k0 + k], 1);
+					} else {
+						const auto col_lo = std::min(cols[k0 + k], cols[k0 + k_end - 1]);
+						const auto col_hi = std::max(cols[k0 + k], cols[k0 + k_end - 1]);
+						load(span_buffer.get(), col_lo, col_hi - col_lo + 1);
+						for (auto kk = k; kk < k_end; kk++) {
+							std::copy(span_buffer.get() + (cols[k0 + kk] - col_lo) * num_rows, span_buffer.get() + (cols[k0 + kk] - col_lo + 1) * num_rows, buffer.get() + kk * num_rows);
+						}
+					}
+					k = k_end;
+				}
+			}
+			for (std::int64_t k = 0; k < num_cols; k++) {
+				for (std::int64_t r = 0; r < rows.length; r++) {
+					dst[r + (k0 + k) * rows.length] = buffer[(rows[r] - row0) + k * num_rows];
+				}
+			}
+		}
+		close(fd);
+		mtk::matfile::detail::check_read_status(status, file_name);
+	}
+
+	template <class T>
+	pybind11::object get_block(
+		const index_range& rows,
+		const index_range& cols
+		) const {
+		if (rows.drop && cols.drop) {
+			T v;
+			{
+				pybind11::gil_scoped_release release;
+				read(&v, rows, cols);
+			}
+			if constexpr (std::is_same<T, mtk::matfile::half>::value) {
+				return pybind11::cast(static_cast<float>(v));
+			} else {
+				return pybind11::cast(v);
+			}
+		}
+
+		std::unique_ptr<T[]> ptr(new T[std::max<std::int64_t>(1, rows.length * cols.length)]);
+		if (rows.length * cols.length != 0) {
+			pybind11::gil_scoped_release release;
+			read(ptr.get(), rows, cols);
+		}
+		if (rows.drop || cols.drop) {
+			return wrap_buffer(ptr.release(), rows.drop ? cols.length : rows.length, 1);
+		}
+		return wrap_buffer(ptr.release(), rows.length, cols.length);
+	}
+public:
+	matfile_object(
+		const std::string file_name
+		) : file_name(file_name), header(mtk::matfile::load_header(file_name)) {
+		if (header.matrix_type != mtk::matfile::matrix_t::dense) {
+			throw std::runtime_error("[matfile error] Not a dense matrix : " + file_name);
+		}
+	}
+
+	pybind11::tuple shape() const {
+		return pybind11::make_tuple(header.m, header.n);
+	}
+
+	pybind11::object dtype() const {
+		pybind11::object dtype;
+		mtk::matfile::detail::dispatch_data_type(header.data_type, [&](const auto tag) {
+			using T = typename python_type<typename decltype(tag)::type>::type;
+			dtype = pybind11::dtype::of<T>();
+		});
+		return dtype;
+	}
+
+	std::uint64_t len() const {return header.m;}
+
+	// mat[i], mat[i0:i1], mat[i, j], mat[i0:i1:s, j0:j1:t] etc.
+	pybind11::object getitem(
+		const pybind11::object key
+		) const {
+		// All columns when only the rows are given
+		index_range rows, cols{0, 1, static_cast<std::int64_t>(header.n), false};
+		if (pybind11::isinstance<pybind11::tuple>(key)) {
+			const auto keys = pybind11::reinterpret_borrow<pybind11::tuple>(key);
+			if (keys.size() != 2) {
+				throw pybind11::index_error("too many indices for a matrix");
+			}
+			rows = get_index_range(keys[0], header.m);
+			cols = get_index_range(keys[1], header.n);
+		} else {
+			rows = get_index_range(key, header.m);
+		}
+
+		pybind11::object result;
+		mtk::matfile::detail::dispatch_data_type(header.data_type, [&](const auto tag) {
+			using T = typename python_type<typename decltype(tag)::type>::type;
+			result = get_block<T>(rows, cols);
+		});
+		return result;
+	}
+};
+
 unsigned get_fp_bit(const std::string file_name) {
 	const auto info = mtk::matfile::load_header(file_name);
 
@@ -93,17 +598,16 @@ unsigned get_fp_bit(const std::string file_name) {
 PYBIND11_MODULE(matfile, m) {
     m.doc() = "matfile";
 
-    m.def("save_dense"    , &save_dense<std::int8_t  >, "", pybind11::arg("matrix"), pybind11::arg("file_name"));
-    m.def("save_dense"    , &save_dense<std::int16_t >, "", pybind11::arg("matrix"), pybind11::arg("file_name"));
-    m.def("save_dense"    , &save_dense<std::int32_t >, "", pybind11::arg("matrix"), pybind11::arg("file_name"));
-    m.def("save_dense"    , &save_dense<std::int64_t >, "", pybind11::arg("matrix"), pybind11::arg("file_name"));
-    m.def("save_dense"    , &save_dense<std::uint8_t >, "", pybind11::arg("matrix"), pybind11::arg("file_name"));
-    m.def("save_dense"    , &save_dense<std::uint16_t>, "", pybind11::arg("matrix"), pybind11::arg("file_name"));
-    m.def("save_dense"    , &save_dense<std::uint32_t>, "", pybind11::arg("matrix"), pybind11::arg("file_name"));
-    m.def("save_dense"    , &save_dense<std::uint64_t>, "", pybind11::arg("matrix"), pybind11::arg("file_name"));
-    m.def("save_dense"    , &save_dense<float        >, "", pybind11::arg("matrix"), pybind11::arg("file_name"));
-    m.def("save_dense"    , &save_dense<double       >, "", pybind11::arg("matrix"), pybind11::arg("file_name"));
-    m.def("load_dense"    , &load_dense, "", pybind11::arg("file_name"));
+    m.def("save_dense"    , &save_dense, "", pybind11::arg("matrix"), pybind11::arg("file_name"), pybind11::arg("dtype") = pybind11::none());
+    m.def("load_dense"    , &load_dense, "", pybind11::arg("file_name"), pybind11::arg("mmap") = false);
+    m.def("load_many"     , &load_many, "", pybind11::arg("file_names"), pybind11::arg("threads") = 0);
+    m.def("save_many"     , &save_many, "", pybind11::arg("matrices"), pybind11::arg("file_names"), pybind11::arg("threads") = 0, pybind11::arg("dtype") = pybind11::none());
+    pybind11::class_<matfile_object>(m, "MatFile")
+        .def(pybind11::init<const std::string>(), pybind11::arg("file_name"))
+        .def_property_readonly("shape", &matfile_object::shape)
+        .def_property_readonly("dtype", &matfile_object::dtype)
+        .def("__len__", &matfile_object::len)
+        .def("__getitem__", &matfile_object::getitem);
+    m.def("open"          , [](const std::string file_name) {return matfile_object(file_name);}, "", pybind11::arg("file_name"));
     //m.def("get_fp_bit"         , &get_fp_bit        , "get_fp_bit"     , pybind11::arg("file_name"));
 }
-
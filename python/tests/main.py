@@ -17,6 +17,95 @@ def eval_mateval(dtype):
         return 0
     return 1
 
+def eval_mmap(dtype):
+    print("## mmap ", dtype)
+    mat = np.random.rand(30, 20).astype(dtype)
+    matfile.save_dense(mat, "test.matrix")
+    mat0 = matfile.load_dense("test.matrix", mmap=True)
+    print("loaded shape = ", mat0.shape)
+    print("writeable = ", mat0.flags.writeable)
+    error = np.linalg.norm(mat - mat0)
+    print("error = ", error)
+    if error == 0 and not mat0.flags.writeable:
+        return 0
+    return 1
+
+def eval_many():
+    print("## many")
+    mats = [np.random.rand(10 + i, 7).astype(dtype) for i, dtype in enumerate([np.float32, np.float64, np.int32, np.uint8])]
+    names = [f"test_{i}.matrix" for i in range(len(mats))]
+    matfile.save_many(mats, names, threads=4)
+    mats0 = matfile.load_many(names, threads=4)
+    num_errors = 0
+    for mat, mat0 in zip(mats, mats0):
+        error = np.linalg.norm(mat - mat0)
+        print("dtype = ", mat0.dtype, ", error = ", error)
+        if error != 0 or mat.dtype != mat0.dtype:
+            num_errors += 1
+    return num_errors
+
+def eval_layout():
+    print("## layout")
+    base = np.random.rand(40, 30)
+    cases = {
+        "C order": base,
+        "F order": np.asfortranarray(base),
+        "strided view": base[::3, 1::2],
+        "reversed view": base[::-1, :],
+    }
+    num_errors = 0
+    for name, mat in cases.items():
+        matfile.save_dense(mat, "test.matrix")
+        error = np.linalg.norm(mat - matfile.load_dense("test.matrix"))
+        print(name, ", error = ", error)
+        num_errors += 0 if error == 0 else 1
+
+    matfile.save_dense(base, "test.matrix", dtype=np.float32)
+    mat0 = matfile.load_dense("test.matrix")
+    error = np.linalg.norm(base.astype(np.float32) - mat0)
+    print("fp64 -> fp32, dtype = ", mat0.dtype, ", error = ", error)
+    num_errors += 0 if error == 0 and mat0.dtype == np.float32 else 1
+    return num_errors
+
+def eval_open():
+    print("## open")
+    mat = np.random.rand(50, 40)
+    matfile.save_dense(mat, "test.matrix")
+    f = matfile.open("test.matrix")
+    print("shape = ", f.shape, ", dtype = ", f.dtype)
+    num_errors = 0 if f.shape == mat.shape and f.dtype == mat.dtype else 1
+    for key in [(slice(3, 13), slice(5, 12)), (slice(None, None, 7), 3), 4, (4, 9), (slice(None, None, -2), slice(39, None, -5)), (-1, slice(None))]:
+        error = np.linalg.norm(np.asarray(mat[key]) - np.asarray(f[key]))
+        same_shape = np.shape(mat[key]) == np.shape(f[key])
+        print(key, ", error = ", error, ", shape = ", np.shape(f[key]))
+        num_errors += 0 if error == 0 and same_shape else 1
+    return num_errors
+
+def eval_fp16():
+    print("## fp16 / bf16")
+    mat = np.random.rand(40, 30).astype(np.float32)
+    num_errors = 0
+
+    matfile.save_dense(mat.astype(np.float16), "test.matrix")
+    mat0 = matfile.load_dense("test.matrix")
+    error = np.linalg.norm(mat.astype(np.float16).astype(np.float32) - mat0.astype(np.float32))
+    print("fp16, dtype = ", mat0.dtype, ", error = ", error)
+    num_errors += 0 if error == 0 and mat0.dtype == np.float16 else 1
+
+    matfile.save_dense(mat, "test.matrix", dtype=np.float16)
+    mat0 = matfile.load_dense("test.matrix", mmap=True)
+    error = np.linalg.norm(mat.astype(np.float16).astype(np.float32) - mat0.astype(np.float32))
+    print("fp32 -> fp16 (mmap), dtype = ", mat0.dtype, ", error = ", error)
+    num_errors += 0 if error == 0 and mat0.dtype == np.float16 else 1
+
+    # bfloat16 files are loaded as float32
+    matfile.save_dense(mat, "test.matrix", dtype="bfloat16")
+    mat0 = matfile.load_dense("test.matrix")
+    error = np.max(np.abs(mat - mat0) / np.abs(mat))
+    print("fp32 -> bf16, dtype = ", mat0.dtype, ", relative error = ", error)
+    num_errors += 0 if error <= 2 ** -8 and mat0.dtype == np.float32 else 1
+    return num_errors
+
 num_errors = 0
 num_errors += eval_mateval(np.float32)
 num_errors += eval_mateval(np.float64)
@@ -28,6 +117,13 @@ num_errors += eval_mateval(np.uint8)
 num_errors += eval_mateval(np.uint16)
 num_errors += eval_mateval(np.uint32)
 num_errors += eval_mateval(np.uint64)
+num_errors += eval_mmap(np.float32)
+num_errors += eval_mmap(np.float64)
+num_errors += eval_mmap(np.int32)
+num_errors += eval_many()
+num_errors += eval_layout()
+num_errors += eval_open()
+num_errors += eval_fp16()
 
 if __name__ == "__main__":
     print(f"Num errors = {num_errors}")
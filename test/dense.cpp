@@ -2,10 +2,15 @@
 #include <memory>
 #include <random>
 #include <limits>
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <cstdio>
 #include <matfile/matfile.hpp>
 
 template <class T>
-int standard_test(const std::uint64_t m, const std::uint64_t n, const std::uint64_t ld) {
+int standard_test(const std::uint64_t m, const std::uint64_t n, const std::uint64_t ld, const mtk::matfile::io_options options = {}) {
 	const std::string file_name = "dense_test.matrix";
 	std::unique_ptr<T[]> mat(new T[ld * n]);
 
@@ -21,16 +26,20 @@ int standard_test(const std::uint64_t m, const std::uint64_t n, const std::uint6
 	mtk::matfile::save_dense(
 		m, n,
 		mat.get(), ld,
-		file_name
+		file_name,
+		mtk::matfile::op_t::no_transpose,
+		options
 		);
 
 	// load meta data
 	const auto [load_m, load_n] = mtk::matfile::load_matrix_size(file_name);
 	const auto dtype = mtk::matfile::load_dtype(file_name);
-	std::printf("TEST >> shape = (%lu, %lu), ld = %lu, dtype = %s (%lu)\n",
+	std::printf("TEST >> shape = (%lu, %lu), ld = %lu, dtype = %s (%lu), threads = %u, direct_io = %d\n",
 							load_m, load_n, ld,
 							mtk::matfile::detail::get_data_type_str(dtype).c_str(),
-							mtk::matfile::get_dtype_size(dtype)
+							mtk::matfile::get_dtype_size(dtype),
+							options.num_threads,
+							options.direct_io
 						 );
 
 	std::unique_ptr<T[]> load_mat(new T[load_m * load_n]);
@@ -38,7 +47,9 @@ int standard_test(const std::uint64_t m, const std::uint64_t n, const std::uint6
 	// load matrix
 	mtk::matfile::load_dense(
 		load_mat.get(), load_m,
-		file_name
+		file_name,
+		mtk::matfile::op_t::no_transpose,
+		options
 		);
 
 	// check
@@ -61,6 +72,1008 @@ int standard_test(const std::uint64_t m, const std::uint64_t n, const std::uint6
 	}
 }
 
+template <class T, class MATFILE_T>
+int transpose_test(const std::uint64_t m, const std::uint64_t n, const mtk::matfile::io_options options) {
+	const std::string file_name = "dense_test.matrix";
+	std::unique_ptr<T[]> mat(new T[m * n]);
+
+	std::uniform_real_distribution<double> dist(-10, 10);
+	std::mt19937 mt(std::random_device{}());
+
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		mat.get()[i] = dist(mt);
+	}
+
+	// save the transposed matrix (n x m)
+	mtk::matfile::save_dense<T, MATFILE_T>(
+		n, m,
+		mat.get(), m,
+		file_name,
+		mtk::matfile::op_t::transpose,
+		options
+		);
+
+	std::unique_ptr<T[]> load_mat(new T[m * n]);
+	mtk::matfile::load_dense(
+		load_mat.get(), m,
+		file_name,
+		mtk::matfile::op_t::transpose,
+		options
+		);
+
+	std::printf("TEST >> transpose, shape = (%lu, %lu), dtype = %s -> %s, threads = %u, direct_io = %d\n",
+							m, n,
+							mtk::matfile::detail::get_type_name_str<T>().c_str(),
+							mtk::matfile::detail::get_type_name_str<MATFILE_T>().c_str(),
+							options.num_threads,
+							options.direct_io
+						 );
+
+	// The loaded matrix must be exactly the one rounded to MATFILE_T
+	std::uint64_t num_mismatches = 0;
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		if (load_mat.get()[i] != static_cast<T>(static_cast<MATFILE_T>(mat.get()[i]))) {
+			num_mismatches++;
+		}
+	}
+
+	if (num_mismatches == 0) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu elements mismatch\n", num_mismatches);
+		return 1;
+	}
+}
+
+template <class T>
+int mapped_test(const std::uint64_t m, const std::uint64_t n) {
+	const std::string file_name = "dense_test.matrix";
+	std::unique_ptr<T[]> mat(new T[m * n]);
+
+	std::uniform_real_distribution<double> dist(-10, 10);
+	std::mt19937 mt(std::random_device{}());
+
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		mat.get()[i] = dist(mt);
+	}
+	mtk::matfile::save_dense(m, n, mat.get(), m, file_name);
+
+	const mtk::matfile::mapped_dense<T> mapped(file_name, mtk::matfile::mmap_hint_t::sequential);
+	std::printf("TEST >> mapped, shape = (%lu, %lu), dtype = %s\n",
+							mapped.m(), mapped.n(),
+							mtk::matfile::detail::get_type_name_str<T>().c_str()
+						 );
+
+	std::uint64_t num_mismatches = 0;
+	for (std::uint64_t i = 0; i < m; i++) {
+		for (std::uint64_t j = 0; j < n; j++) {
+			if (mapped(i, j) != mat.get()[i + j * m]) {
+				num_mismatches++;
+			}
+		}
+	}
+
+	if (mapped.m() == m && mapped.n() == n && num_mismatches == 0) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu elements mismatch\n", num_mismatches);
+		return 1;
+	}
+}
+
+// A corrupted header whose m * n * sizeof(T) overflows must not pass the size check
+int mapped_overflow_test() {
+	const std::string file_name = "dense_test.matrix";
+	std::vector<double> mat(16 * 8, 1);
+	mtk::matfile::save_dense(16, 8, mat.data(), 16, file_name);
+	auto header = mtk::matfile::load_header(file_name);
+	header.m = 1lu << 61;
+	{
+		std::fstream fs(file_name, std::ios::binary | std::ios::in | std::ios::out);
+		fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	}
+	std::printf("TEST >> mapped overflow, shape = (%lu, %lu)\n", header.m, header.n);
+
+	try {
+		const mtk::matfile::mapped_dense<double> mapped(file_name);
+	} catch (const std::runtime_error& e) {
+		if (std::string(e.what()).find("Truncated file") != std::string::npos) {
+			std::printf("<< PASSED\n");
+			return 0;
+		}
+	}
+	std::printf("<< FAILED\n");
+	return 1;
+}
+
+template <class T, class MATFILE_T>
+int block_test(
+	const std::uint64_t m, const std::uint64_t n,
+	const std::uint64_t row0, const std::uint64_t col0,
+	const std::uint64_t rows, const std::uint64_t cols,
+	const mtk::matfile::op_t op,
+	const unsigned num_threads
+	) {
+	const std::string file_name = "dense_test.matrix";
+	std::unique_ptr<T[]> mat(new T[m * n]);
+
+	std::uniform_real_distribution<double> dist(-10, 10);
+	std::mt19937 mt(std::random_device{}());
+
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		mat.get()[i] = dist(mt);
+	}
+	mtk::matfile::save_dense<T, MATFILE_T>(m, n, mat.get(), m, file_name);
+
+	const auto ld = op == mtk::matfile::op_t::no_transpose ? rows : cols;
+	std::unique_ptr<T[]> block(new T[rows * cols]);
+	mtk::matfile::load_dense_block(
+		block.get(), ld,
+		file_name,
+		row0, col0, rows, cols,
+		op,
+		{num_threads}
+		);
+
+	std::printf("TEST >> block, shape = (%lu, %lu), block = (%lu:%lu, %lu:%lu), op = %s, threads = %u\n",
+							m, n,
+							row0, row0 + rows, col0, col0 + cols,
+							op == mtk::matfile::op_t::no_transpose ? "N" : "T",
+							num_threads
+						 );
+
+	std::uint64_t num_mismatches = 0;
+	for (std::uint64_t i = 0; i < rows; i++) {
+		for (std::uint64_t j = 0; j < cols; j++) {
+			const auto v = op == mtk::matfile::op_t::no_transpose ? block.get()[i + j * ld] : block.get()[j + i * ld];
+			if (v != static_cast<T>(static_cast<MATFILE_T>(mat.get()[(row0 + i) + (col0 + j) * m]))) {
+				num_mismatches++;
+			}
+		}
+	}
+
+	if (num_mismatches == 0) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu elements mismatch\n", num_mismatches);
+		return 1;
+	}
+}
+
+template <class T, class MATFILE_T>
+int writer_test(const std::uint64_t m, const std::uint64_t n, const std::uint64_t panel_width) {
+	const std::string file_name = "dense_test.matrix";
+	std::unique_ptr<T[]> mat(new T[m * n]);
+
+	std::uniform_real_distribution<double> dist(-10, 10);
+	std::mt19937 mt(std::random_device{}());
+
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		mat.get()[i] = dist(mt);
+	}
+
+	mtk::matfile::dense_writer<T, MATFILE_T> writer(m, n, file_name);
+	for (std::uint64_t j = 0; j < n; j += panel_width) {
+		writer.append_columns(mat.get() + j * m, m, std::min(panel_width, n - j));
+	}
+	writer.close();
+
+	std::printf("TEST >> writer, shape = (%lu, %lu), panel width = %lu, dtype = %s -> %s\n",
+							m, n, panel_width,
+							mtk::matfile::detail::get_type_name_str<T>().c_str(),
+							mtk::matfile::detail::get_type_name_str<MATFILE_T>().c_str()
+						 );
+
+	std::unique_ptr<T[]> load_mat(new T[m * n]);
+	mtk::matfile::load_dense(load_mat.get(), m, file_name);
+
+	std::uint64_t num_mismatches = 0;
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		if (load_mat.get()[i] != static_cast<T>(static_cast<MATFILE_T>(mat.get()[i]))) {
+			num_mismatches++;
+		}
+	}
+
+	// Closing an incomplete file must fail
+	bool incomplete_detected = false;
+	try {
+		mtk::matfile::dense_writer<T, MATFILE_T> incomplete_writer(m, n + 1, file_name);
+		incomplete_writer.append_columns(mat.get(), m, n);
+		incomplete_writer.close();
+	} catch (const std::runtime_error&) {
+		incomplete_detected = true;
+	}
+
+	if (num_mismatches == 0 && incomplete_detected) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu elements mismatch, incomplete file detected = %d\n", num_mismatches, incomplete_detected);
+		return 1;
+	}
+}
+
+template <class T, class MATFILE_T>
+int reader_test(const std::uint64_t m, const std::uint64_t n, const std::uint64_t panel_width, const bool prefetch) {
+	const std::string file_name = "dense_test.matrix";
+	std::unique_ptr<T[]> mat(new T[m * n]);
+
+	std::uniform_real_distribution<double> dist(-10, 10);
+	std::mt19937 mt(std::random_device{}());
+
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		mat.get()[i] = dist(mt);
+	}
+	mtk::matfile::save_dense<T, MATFILE_T>(m, n, mat.get(), m, file_name);
+
+	std::printf("TEST >> reader, shape = (%lu, %lu), panel width = %lu, prefetch = %d\n",
+							m, n, panel_width, prefetch
+						 );
+
+	const auto check = [&](const T* const ptr, const std::uint64_t col0, const std::uint64_t cols) {
+		std::uint64_t num_mismatches = 0;
+		for (std::uint64_t i = 0; i < m * cols; i++) {
+			if (ptr[i] != static_cast<T>(static_cast<MATFILE_T>(mat.get()[col0 * m + i]))) {
+				num_mismatches++;
+			}
+		}
+		return num_mismatches;
+	};
+
+	// Alternate the internal buffer and a caller-provided buffer
+	mtk::matfile::dense_reader<T> reader(file_name, panel_width, prefetch);
+	std::unique_ptr<T[]> panel(new T[m * panel_width]);
+	std::uint64_t num_mismatches = 0;
+	std::uint64_t num_read_cols = 0;
+	for (unsigned k = 0; num_read_cols < n; k++) {
+		std::uint64_t cols;
+		if (k % 3 == 2) {
+			cols = reader.read_panel(panel.get(), m);
+			num_mismatches += check(panel.get(), num_read_cols, cols);
+		} else {
+			cols = reader.next_panel();
+			num_mismatches += check(reader.panel_data(), reader.panel_col0(), cols);
+		}
+		if (cols == 0) {
+			break;
+		}
+		num_read_cols += cols;
+	}
+	const auto end_detected = reader.next_panel() == 0;
+
+	if (num_mismatches == 0 && num_read_cols == n && end_detected) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu elements mismatch, %lu columns read\n", num_mismatches, num_read_cols);
+		return 1;
+	}
+}
+
+template <class T, class MATFILE_T>
+int async_test(const std::uint64_t m, const std::uint64_t n, const unsigned num_files, const mtk::matfile::io_options options = {}) {
+	std::vector<std::unique_ptr<T[]>> mats(num_files);
+	std::vector<std::unique_ptr<T[]>> load_mats(num_files);
+
+	std::uniform_real_distribution<double> dist(-10, 10);
+	std::mt19937 mt(std::random_device{}());
+
+	const auto get_file_name = [](const unsigned i) {return "dense_test_" + std::to_string(i) + ".matrix";};
+
+	std::vector<std::future<void>> futures;
+	for (unsigned k = 0; k < num_files; k++) {
+		mats[k].reset(new T[m * n]);
+		for (std::uint64_t i = 0; i < m * n; i++) {
+			mats[k].get()[i] = dist(mt);
+		}
+		futures.push_back(mtk::matfile::save_dense_async<T, MATFILE_T>(m, n, mats[k].get(), m, get_file_name(k), mtk::matfile::op_t::no_transpose, options));
+	}
+	for (auto& f : futures) {
+		f.get();
+	}
+	futures.clear();
+
+	// The options must not be dropped by the io_uring path
+	std::uint64_t num_ignored_options = 0;
+	for (unsigned k = 0; k < num_files; k++) {
+		const auto header = mtk::matfile::load_header(get_file_name(k));
+		num_ignored_options += (options.codec != mtk::matfile::codec_t::none) != mtk::matfile::detail::is_encoded(header);
+		num_ignored_options += options.checksum != mtk::matfile::detail::get_checksum(header);
+	}
+
+	for (unsigned k = 0; k < num_files; k++) {
+		load_mats[k].reset(new T[m * n]);
+		futures.push_back(mtk::matfile::load_dense_async(load_mats[k].get(), m, get_file_name(k)));
+	}
+	for (auto& f : futures) {
+		f.get();
+	}
+
+	std::printf("TEST >> async, shape = (%lu, %lu), files = %u, codec = %u, checksum = %u, dtype = %s -> %s\n",
+							m, n, num_files, static_cast<unsigned>(options.codec), static_cast<unsigned>(options.checksum),
+							mtk::matfile::detail::get_type_name_str<T>().c_str(),
+							mtk::matfile::detail::get_type_name_str<MATFILE_T>().c_str()
+						 );
+
+	std::uint64_t num_mismatches = 0;
+	for (unsigned k = 0; k < num_files; k++) {
+		for (std::uint64_t i = 0; i < m * n; i++) {
+			if (load_mats[k].get()[i] != static_cast<T>(static_cast<MATFILE_T>(mats[k].get()[i]))) {
+				num_mismatches++;
+			}
+		}
+		std::remove(get_file_name(k).c_str());
+	}
+
+	// Errors are reported through the future
+	bool error_detected = false;
+	try {
+		mtk::matfile::load_dense_async(load_mats[0].get(), m, "dense_test_no_such_file.matrix").get();
+	} catch (const std::runtime_error&) {
+		error_detected = true;
+	}
+
+	if (num_mismatches == 0 && num_ignored_options == 0 && error_detected) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu elements mismatch, %lu options ignored, error detected = %d\n", num_mismatches, num_ignored_options, error_detected);
+		return 1;
+	}
+}
+
+template <class T, class MATFILE_T>
+int codec_test(const std::uint64_t m, const std::uint64_t n, const std::uint64_t chunk_cols, const mtk::matfile::op_t op, const unsigned num_threads, const mtk::matfile::filter_t filter = mtk::matfile::filter_t::none, const bool direct_io = false) {
+	const std::string file_name = "dense_test.matrix";
+	std::unique_ptr<T[]> mat(new T[m * n]);
+
+	// `mat` is (m x n) in the file regardless of op
+	const auto ld = op == mtk::matfile::op_t::no_transpose ? m : n;
+
+	// Low-entropy data (runs of small integers in the file order)
+	std::uniform_int_distribution<int> dist(-4, 4);
+	std::mt19937 mt(std::random_device{}());
+	T v = 0;
+	for (std::uint64_t j = 0; j < n; j++) {
+		for (std::uint64_t i = 0; i < m; i++) {
+			if ((i + j * m) % 8 == 0) {
+				v = dist(mt);
+			}
+			mat.get()[op == mtk::matfile::op_t::no_transpose ? i + j * ld : j + i * ld] = v;
+		}
+	}
+
+	mtk::matfile::io_options options;
+	options.num_threads = num_threads;
+	options.codec = mtk::matfile::codec_t::builtin;
+	options.chunk_cols = chunk_cols;
+	options.filter = filter;
+	options.direct_io = direct_io;
+
+	mtk::matfile::save_dense<T, MATFILE_T>(m, n, mat.get(), ld, file_name, op, options);
+
+	std::ifstream ifs(file_name, std::ios::binary | std::ios::ate);
+	const std::uint64_t file_size = ifs.tellg();
+	ifs.close();
+
+	std::printf("TEST >> codec, shape = (%lu, %lu), chunk cols = %lu, filter = %u, op = %s, threads = %u, direct_io = %d, dtype = %s -> %s, compression ratio = %.2f\n",
+							m, n, chunk_cols, static_cast<unsigned>(filter),
+							op == mtk::matfile::op_t::no_transpose ? "N" : "T",
+							num_threads,
+							direct_io,
+							mtk::matfile::detail::get_type_name_str<T>().c_str(),
+							mtk::matfile::detail::get_type_name_str<MATFILE_T>().c_str(),
+							static_cast<double>(m * n * sizeof(MATFILE_T)) / file_size
+						 );
+
+	std::uint64_t num_mismatches = 0;
+
+	// Full load
+	std::unique_ptr<T[]> load_mat(new T[m * n]);
+	mtk::matfile::load_dense(load_mat.get(), ld, file_name, op, options);
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		if (load_mat.get()[i] != mat.get()[i]) {
+			num_mismatches++;
+		}
+	}
+
+	// Partial load
+	const auto row0 = m / 3;
+	const auto col0 = n / 3;
+	const auto rows = m / 2;
+	const auto cols = n / 2;
+	mtk::matfile::load_dense_block(load_mat.get(), rows, file_name, row0, col0, rows, cols);
+	for (std::uint64_t i = 0; i < rows; i++) {
+		for (std::uint64_t j = 0; j < cols; j++) {
+			const auto index = op == mtk::matfile::op_t::no_transpose ? (row0 + i) + (col0 + j) * ld : (col0 + j) + (row0 + i) * ld;
+			if (load_mat.get()[i + j * rows] != mat.get()[index]) {
+				num_mismatches++;
+			}
+		}
+	}
+
+	// Panel reader
+	mtk::matfile::dense_reader<T> reader(file_name, 7);
+	std::uint64_t num_cols;
+	while ((num_cols = reader.next_panel()) != 0) {
+		for (std::uint64_t i = 0; i < m; i++) {
+			for (std::uint64_t j = 0; j < num_cols; j++) {
+				const auto index = op == mtk::matfile::op_t::no_transpose ? i + (reader.panel_col0() + j) * ld : (reader.panel_col0() + j) + i * ld;
+				if (reader.panel_data()[i + j * m] != mat.get()[index]) {
+					num_mismatches++;
+				}
+			}
+		}
+	}
+
+	if (num_mismatches == 0 && file_size < m * n * sizeof(MATFILE_T)) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu elements mismatch\n", num_mismatches);
+		return 1;
+	}
+}
+
+// Saturating conversion computed in long double
+template <class DST, class SRC>
+DST saturate_reference(const SRC v, const bool round) {
+	if (v != v) {
+		return 0;
+	}
+	auto r = static_cast<long double>(v);
+	r = round ? std::nearbyint(r) : std::trunc(r);
+	r = std::min(std::max(r, static_cast<long double>(std::numeric_limits<DST>::min())), static_cast<long double>(std::numeric_limits<DST>::max()));
+	return static_cast<DST>(r);
+}
+
+template <class SRC, class DST>
+int convert_test(const std::uint64_t m, const std::uint64_t n, const mtk::matfile::op_t op, const mtk::matfile::convert_t convert, const unsigned num_threads) {
+	const std::string file_name = "dense_test.matrix";
+	std::unique_ptr<SRC[]> mat(new SRC[m * n]);
+
+	// Cover the range of DST twice with halves, edges and non-finite values
+	const auto dst_min = static_cast<long double>(std::numeric_limits<DST>::min());
+	const auto dst_max = static_cast<long double>(std::numeric_limits<DST>::max());
+	std::uniform_real_distribution<long double> dist(
+		std::max<long double>(2 * dst_min - 3, std::numeric_limits<SRC>::lowest()),
+		std::min<long double>(2 * dst_max + 3, std::numeric_limits<SRC>::max())
+		);
+	std::mt19937 mt(std::random_device{}());
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		auto v = dist(mt);
+		if (i % 3 == 0) {
+			v = std::floor(v) + 0.5l;
+		}
+		mat.get()[i] = static_cast<SRC>(std::min<long double>(std::max<long double>(v, std::numeric_limits<SRC>::lowest()), std::numeric_limits<SRC>::max()));
+	}
+	const std::vector<long double> edges = {0.5, 1.5, 2.5, -0.5, -1.5, dst_max, dst_max + 1, dst_min, dst_min - 1};
+	for (std::size_t i = 0; i < edges.size() && i < m * n; i++) {
+		mat.get()[i] = static_cast<SRC>(std::min<long double>(std::max<long double>(edges[i], std::numeric_limits<SRC>::lowest()), std::numeric_limits<SRC>::max()));
+	}
+	if constexpr (std::is_floating_point<SRC>::value) {
+		if (m * n > edges.size() + 2) {
+			mat.get()[edges.size() + 0] = std::numeric_limits<SRC>::quiet_NaN();
+			mat.get()[edges.size() + 1] = -std::numeric_limits<SRC>::infinity();
+		}
+	}
+
+	mtk::matfile::io_options options;
+	options.num_threads = num_threads;
+	options.convert = convert;
+	const auto round = convert == mtk::matfile::convert_t::round_saturate;
+
+	std::printf("TEST >> convert, shape = (%lu, %lu), dtype = %s -> %s, op = %s, mode = %s, threads = %u\n",
+							m, n,
+							mtk::matfile::detail::get_type_name_str<SRC>().c_str(),
+							mtk::matfile::detail::get_type_name_str<DST>().c_str(),
+							op == mtk::matfile::op_t::transpose ? "T" : "N",
+							round ? "round_saturate" : "saturate",
+							num_threads
+						 );
+
+	std::uint64_t num_mismatches = 0;
+	std::unique_ptr<DST[]> load_mat(new DST[m * n]);
+
+	// Conversion on save
+	mtk::matfile::save_dense<SRC, DST>(
+		op == mtk::matfile::op_t::transpose ? n : m, op == mtk::matfile::op_t::transpose ? m : n,
+		mat.get(), m,
+		file_name,
+		op,
+		options
+		);
+	mtk::matfile::load_dense(load_mat.get(), m, file_name, op);
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		if (load_mat.get()[i] != saturate_reference<DST>(mat.get()[i], round)) {
+			num_mismatches++;
+		}
+	}
+
+	// Conversion on load
+	mtk::matfile::save_dense(
+		op == mtk::matfile::op_t::transpose ? n : m, op == mtk::matfile::op_t::transpose ? m : n,
+		mat.get(), m,
+		file_name,
+		op
+		);
+	mtk::matfile::load_dense(load_mat.get(), m, file_name, op, options);
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		if (load_mat.get()[i] != saturate_reference<DST>(mat.get()[i], round)) {
+			num_mismatches++;
+		}
+	}
+
+	if (num_mismatches == 0) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu elements mismatch\n", num_mismatches);
+		return 1;
+	}
+}
+
+// Save T as 16-bit floating point and load it back
+template <class T, class MATFILE_T>
+int fp16_test(const std::uint64_t m, const std::uint64_t n, const mtk::matfile::op_t op, const mtk::matfile::io_options options) {
+	const std::string file_name = "dense_test.matrix";
+	std::unique_ptr<T[]> mat(new T[m * n]);
+
+	std::uniform_real_distribution<double> dist(-1000, 1000);
+	std::mt19937 mt(std::random_device{}());
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		mat.get()[i] = dist(mt) * (i % 2 == 0 ? 1 : 1e-6);
+	}
+
+	mtk::matfile::save_dense<T, MATFILE_T>(
+		op == mtk::matfile::op_t::transpose ? n : m, op == mtk::matfile::op_t::transpose ? m : n,
+		mat.get(), m,
+		file_name,
+		op,
+		options
+		);
+
+	std::unique_ptr<T[]> load_mat(new T[m * n]);
+	mtk::matfile::load_dense(load_mat.get(), m, file_name, op, options);
+
+	std::printf("TEST >> fp16, shape = (%lu, %lu), dtype = %s -> %s (%lu), op = %s, threads = %u\n",
+							m, n,
+							mtk::matfile::detail::get_type_name_str<T>().c_str(),
+							mtk::matfile::detail::get_data_type_str(mtk::matfile::load_dtype(file_name)).c_str(),
+							mtk::matfile::get_dtype_size(mtk::matfile::load_dtype(file_name)),
+							op == mtk::matfile::op_t::transpose ? "T" : "N",
+							options.num_threads
+						 );
+
+	// The loaded matrix must be exactly the one rounded to MATFILE_T through float
+	std::uint64_t num_mismatches = 0;
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		if (load_mat.get()[i] != static_cast<T>(static_cast<float>(MATFILE_T(static_cast<float>(mat.get()[i]))))) {
+			num_mismatches++;
+		}
+	}
+
+	if (num_mismatches == 0) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu elements mismatch\n", num_mismatches);
+		return 1;
+	}
+}
+
+// Every non-NaN fp16/bf16 value must survive the round trip through float
+template <class MATFILE_T>
+int fp16_roundtrip_test() {
+	std::uint64_t num_failed = 0;
+	for (std::uint32_t i = 0; i < 0x10000; i++) {
+		MATFILE_T h;
+		h.bits = i;
+		const auto v = static_cast<float>(h);
+		if (v == v && MATFILE_T(v).bits != h.bits) {
+			num_failed++;
+		}
+	}
+
+	std::printf("TEST >> %s round trip\n", mtk::matfile::detail::get_type_name_str<MATFILE_T>().c_str());
+	if (num_failed == 0) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu cases\n", num_failed);
+		return 1;
+	}
+}
+
+template <class T>
+int quantize_test(const std::uint64_t m, const std::uint64_t n, const mtk::matfile::quantize_t quantize, const std::uint64_t block, const bool stochastic, const mtk::matfile::codec_t codec, const unsigned num_threads) {
+	const std::string file_name = "dense_test.matrix";
+	std::unique_ptr<T[]> mat(new T[m * n]);
+
+	// Columns with different ranges
+	std::uniform_real_distribution<T> dist(-1, 1);
+	std::mt19937 mt(std::random_device{}());
+	for (std::uint64_t j = 0; j < n; j++) {
+		for (std::uint64_t i = 0; i < m; i++) {
+			mat.get()[i + j * m] = dist(mt) * (j + 1) + j;
+		}
+	}
+
+	mtk::matfile::io_options options;
+	options.num_threads = num_threads;
+	options.codec = codec;
+	options.chunk_cols = 13;
+	options.quantize = quantize;
+	options.quantize_block = block;
+	options.stochastic_rounding = stochastic;
+	mtk::matfile::save_dense(m, n, mat.get(), m, file_name, mtk::matfile::op_t::no_transpose, options);
+
+	std::ifstream ifs(file_name, std::ios::binary | std::ios::ate);
+	const std::uint64_t file_size = ifs.tellg();
+	ifs.close();
+
+	std::printf("TEST >> quantize, shape = (%lu, %lu), dtype = %s, mode = %s, block = %lu, stochastic = %d, codec = %u, threads = %u, compression ratio = %.2f\n",
+							m, n,
+							mtk::matfile::detail::get_type_name_str<T>().c_str(),
+							quantize == mtk::matfile::quantize_t::int4 ? "int4" : "int8",
+							block, stochastic, static_cast<unsigned>(codec), num_threads,
+							static_cast<double>(m * n * sizeof(T)) / file_size
+						 );
+
+	// The error of each element is bounded by the step of its block (half of it when rounding to the nearest)
+	const auto max_code = quantize == mtk::matfile::quantize_t::int4 ? 15 : 255;
+	const auto block_rows = block == 0 ? m : block;
+	std::unique_ptr<T[]> load_mat(new T[m * n]);
+	mtk::matfile::load_dense(load_mat.get(), m, file_name, mtk::matfile::op_t::no_transpose, options);
+	std::uint64_t num_mismatches = 0;
+	for (std::uint64_t j = 0; j < n; j++) {
+		for (std::uint64_t i0 = 0; i0 < m; i0 += block_rows) {
+			const auto i1 = std::min(i0 + block_rows, m);
+			const auto [min, max] = std::minmax_element(mat.get() + i0 + j * m, mat.get() + i1 + j * m);
+			const auto step = (*max - *min) / max_code;
+			const auto bound = step * (stochastic ? 1 : 0.5) * (1 + 1e-3) + 4 * std::numeric_limits<T>::epsilon() * std::abs(*max);
+			for (std::uint64_t i = i0; i < i1; i++) {
+				if (std::abs(load_mat.get()[i + j * m] - mat.get()[i + j * m]) > bound) {
+					num_mismatches++;
+				}
+			}
+		}
+	}
+
+	// Partial load must be identical to the full load
+	const auto row0 = m / 3;
+	const auto col0 = n / 3;
+	const auto rows = m / 2;
+	const auto cols = n / 2;
+	std::unique_ptr<T[]> block_mat(new T[rows * cols]);
+	mtk::matfile::load_dense_block(block_mat.get(), rows, file_name, row0, col0, rows, cols);
+	for (std::uint64_t i = 0; i < rows; i++) {
+		for (std::uint64_t j = 0; j < cols; j++) {
+			if (block_mat.get()[i + j * rows] != load_mat.get()[(row0 + i) + (col0 + j) * m]) {
+				num_mismatches++;
+			}
+		}
+	}
+
+	// A code and the offset and scale shared by a block per element
+	const auto bytes_per_element = (quantize == mtk::matfile::quantize_t::int4 ? 0.5 : 1.) + 2. * sizeof(T) / block_rows;
+	const auto min_ratio = sizeof(T) / bytes_per_element * 0.9;
+	if (num_mismatches == 0 && static_cast<double>(m * n * sizeof(T)) / file_size > min_ratio) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu elements mismatch\n", num_mismatches);
+		return 1;
+	}
+}
+
+template <class T, class MATFILE_T>
+int checksum_test(const std::uint64_t m, const std::uint64_t n, const std::uint64_t chunk_cols, const std::uint64_t padding, const mtk::matfile::codec_t codec, const mtk::matfile::op_t op, const unsigned num_threads, const bool direct_io = false) {
+	const std::string file_name = "dense_test.matrix";
+
+	// `mat` is (m x n) in the file regardless of op
+	const auto ld = (op == mtk::matfile::op_t::no_transpose ? m : n) + padding;
+	const auto index = [&](const std::uint64_t i, const std::uint64_t j) {return op == mtk::matfile::op_t::no_transpose ? i + j * ld : j + i * ld;};
+	const auto size = ld * (op == mtk::matfile::op_t::no_transpose ? n : m);
+	std::unique_ptr<T[]> mat(new T[size]);
+
+	// Small integers are exactly representable in all types used here
+	std::uniform_int_distribution<int> dist(-100, 100);
+	std::mt19937 mt(std::random_device{}());
+	for (std::uint64_t j = 0; j < n; j++) {
+		for (std::uint64_t i = 0; i < m; i++) {
+			mat.get()[index(i, j)] = dist(mt);
+		}
+	}
+
+	mtk::matfile::io_options options;
+	options.num_threads = num_threads;
+	options.codec = codec;
+	options.chunk_cols = chunk_cols;
+	options.checksum = mtk::matfile::checksum_t::crc32c;
+	options.direct_io = direct_io;
+	mtk::matfile::save_dense<T, MATFILE_T>(m, n, mat.get(), ld, file_name, op, options);
+
+	std::printf("TEST >> checksum, shape = (%lu, %lu), chunk cols = %lu, ld = %lu, codec = %u, op = %s, threads = %u, direct_io = %d, dtype = %s -> %s\n",
+							m, n, chunk_cols, ld, static_cast<unsigned>(codec),
+							op == mtk::matfile::op_t::no_transpose ? "N" : "T",
+							num_threads,
+							direct_io,
+							mtk::matfile::detail::get_type_name_str<T>().c_str(),
+							mtk::matfile::detail::get_type_name_str<MATFILE_T>().c_str()
+						 );
+
+	std::uint64_t num_errors = mtk::matfile::verify_dense(file_name, num_threads).size();
+
+	// Full load, partial load and panel reader
+	std::unique_ptr<T[]> load_mat(new T[size]);
+	mtk::matfile::load_dense(load_mat.get(), ld, file_name, op, options);
+	for (std::uint64_t j = 0; j < n; j++) {
+		for (std::uint64_t i = 0; i < m; i++) {
+			if (load_mat.get()[index(i, j)] != mat.get()[index(i, j)]) {
+				num_errors++;
+			}
+		}
+	}
+	const auto row0 = m / 3;
+	const auto col0 = n / 3;
+	const auto rows = m / 2;
+	const auto cols = n / 2;
+	mtk::matfile::load_dense_block(load_mat.get(), rows, file_name, row0, col0, rows, cols);
+	for (std::uint64_t i = 0; i < rows; i++) {
+		for (std::uint64_t j = 0; j < cols; j++) {
+			if (load_mat.get()[i + j * rows] != mat.get()[index(row0 + i, col0 + j)]) {
+				num_errors++;
+			}
+		}
+	}
+	mtk::matfile::dense_reader<T> reader(file_name, 7, true);
+	std::uint64_t num_cols;
+	while ((num_cols = reader.next_panel()) != 0) {
+		for (std::uint64_t i = 0; i < m; i++) {
+			for (std::uint64_t j = 0; j < num_cols; j++) {
+				if (reader.panel_data()[i + j * m] != mat.get()[index(i, reader.panel_col0() + j)]) {
+					num_errors++;
+				}
+			}
+		}
+	}
+
+	// Flip a bit of the last chunk, which is followed by the trailer of (num_chunks + 1) checksums
+	const auto header = mtk::matfile::load_header(file_name);
+	const auto num_chunks = (n + header.a1 - 1) / header.a1;
+	const auto file_size = std::filesystem::file_size(file_name);
+	{
+		std::fstream fs(file_name, std::ios::binary | std::ios::in | std::ios::out);
+		fs.seekg(file_size - (num_chunks + 1) * sizeof(std::uint32_t) - 1);
+		const auto c = static_cast<char>(fs.get() ^ 0x10);
+		fs.seekp(file_size - (num_chunks + 1) * sizeof(std::uint32_t) - 1);
+		fs.put(c);
+	}
+	const auto corrupted = mtk::matfile::verify_dense(file_name, num_threads);
+	if (corrupted.size() != 1 || corrupted[0] != num_chunks - 1) {
+		num_errors++;
+	}
+	try {
+		mtk::matfile::load_dense(load_mat.get(), ld, file_name, op, options);
+		num_errors++;
+	} catch (const std::runtime_error& e) {
+		if (std::string(e.what()).find("Checksum mismatch") == std::string::npos) {
+			num_errors++;
+		}
+	}
+	if (num_chunks > 1) {
+		// The other chunks can still be loaded
+		mtk::matfile::load_dense_block(load_mat.get(), m, file_name, 0, 0, m, header.a1);
+	}
+
+	// Truncated file
+	std::filesystem::resize_file(file_name, file_size - 1);
+	try {
+		mtk::matfile::verify_dense(file_name, num_threads);
+		num_errors++;
+	} catch (const std::runtime_error&) {}
+	try {
+		mtk::matfile::load_dense(load_mat.get(), ld, file_name, op, options);
+		num_errors++;
+	} catch (const std::runtime_error&) {}
+
+	if (num_errors == 0) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu errors\n", num_errors);
+		return 1;
+	}
+}
+
+#ifndef MATFILE_USE_OLD_FORMAT
+// Version 0.7 files were written with uninitialized reserved fields
+int legacy_header_test() {
+	const std::string file_name = "dense_test.matrix";
+	const std::uint64_t m = 30, n = 20;
+	std::vector<double> mat(m * n);
+	for (std::uint64_t i = 0; i < m * n; i++) {
+		mat[i] = i;
+	}
+
+	auto header = mtk::matfile::detail::make_dense_header<double>(m, n);
+	header.a0 = 0x7ffedd3dee10;
+	header.a1 = 0x7ffedd3dee20;
+	header.a2 = 0x7ffedd3dee28;
+	header.a3 = 0x7ffedd3dee2f;
+	std::ofstream ofs(file_name, std::ios::binary);
+	ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	ofs.write(reinterpret_cast<const char*>(mat.data()), mat.size() * sizeof(double));
+	ofs.close();
+	std::printf("TEST >> legacy header, shape = (%lu, %lu)\n", m, n);
+
+	std::uint64_t num_errors = 0;
+	std::vector<double> load_mat(m * n);
+	try {
+		mtk::matfile::load_dense(load_mat.data(), m, file_name);
+		num_errors += load_mat != mat;
+		mtk::matfile::load_dense_block(load_mat.data(), m, file_name, 0, 5, m, 3);
+		num_errors += !std::equal(load_mat.begin(), load_mat.begin() + m * 3, mat.begin() + m * 5);
+	} catch (const std::runtime_error& e) {
+		std::printf("%s\n", e.what());
+		num_errors++;
+	}
+
+	if (num_errors == 0) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu errors\n", num_errors);
+		return 1;
+	}
+}
+#endif
+
+int index_test(const unsigned num_threads) {
+	const std::string index_name = "dense_test.index";
+	std::vector<std::string> file_names;
+	std::vector<float> mat(100 * 100, 1);
+	for (unsigned i = 0; i < 8; i++) {
+		file_names.push_back("dense_test_" + std::to_string(i) + ".matrix");
+		mtk::matfile::save_dense<float, double>(10 + i, 20 + i, mat.data(), 10 + i, file_names.back());
+	}
+	std::printf("TEST >> index, files = %lu, threads = %u\n", file_names.size(), num_threads);
+
+	std::uint64_t num_errors = 0;
+	const auto headers = mtk::matfile::load_headers(file_names, num_threads);
+	for (unsigned i = 0; i < file_names.size(); i++) {
+		if (headers[i].m != 10 + i || headers[i].n != 20 + i || headers[i].data_type != mtk::matfile::data_t::fp64) {
+			num_errors++;
+		}
+	}
+	try {
+		mtk::matfile::load_headers({file_names[0], "dense_test_missing.matrix"}, num_threads);
+		num_errors++;
+	} catch (const std::runtime_error&) {}
+
+	// A missing file and a file shorter than the header are left out of the index
+	std::ofstream("dense_test_short.matrix") << "short";
+	auto index_names = file_names;
+	index_names.push_back("dense_test_missing.matrix");
+	index_names.push_back("dense_test_short.matrix");
+	std::remove(index_name.c_str());
+	auto entries = mtk::matfile::update_index(index_name, index_names, num_threads);
+	num_errors += entries.size() != file_names.size();
+
+	// Only the entry of the rewritten file changes
+	mtk::matfile::io_options options;
+#ifndef MATFILE_USE_OLD_FORMAT
+	options.checksum = mtk::matfile::checksum_t::crc32c;
+#endif
+	mtk::matfile::save_dense<float, float>(100, 3, mat.data(), 100, file_names[3], mtk::matfile::op_t::no_transpose, options);
+	entries = mtk::matfile::update_index(index_name, index_names, num_threads);
+	const auto loaded_entries = mtk::matfile::load_index(index_name);
+	num_errors += entries.size() != file_names.size() || loaded_entries.size() != file_names.size();
+	for (unsigned i = 0; i < std::min(entries.size(), loaded_entries.size()); i++) {
+		const auto& e = loaded_entries[i];
+		const auto expected_m = i == 3 ? 100 : 10 + i;
+		const auto expected_n = i == 3 ? 3 : 20 + i;
+		const auto expected_dtype = i == 3 ? mtk::matfile::data_t::fp32 : mtk::matfile::data_t::fp64;
+		if (e.path != file_names[i] || e.m != expected_m || e.n != expected_n || e.data_type != expected_dtype || e.matrix_type != mtk::matfile::matrix_t::dense ||
+				e.checksum != (i == 3 ? options.checksum : mtk::matfile::checksum_t::none) || e.mtime != entries[i].mtime || e.file_size != std::filesystem::file_size(file_names[i])) {
+			num_errors++;
+		}
+	}
+
+	for (const auto& file_name : index_names) {
+		std::remove(file_name.c_str());
+	}
+	std::remove(index_name.c_str());
+
+	if (num_errors == 0) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu errors\n", num_errors);
+		return 1;
+	}
+}
+
+// Options which the build cannot encode are rejected before the file is created
+int unsupported_options_test() {
+	const std::string file_name = "dense_test.matrix";
+	std::vector<double> mat(100 * 70, 1);
+	std::vector<mtk::matfile::io_options> cases;
+#ifndef MATFILE_USE_LZ4
+	cases.push_back({4});
+	cases.back().codec = mtk::matfile::codec_t::lz4;
+#endif
+#ifndef MATFILE_USE_ZSTD
+	cases.push_back({4});
+	cases.back().codec = mtk::matfile::codec_t::zstd;
+#endif
+	cases.push_back({4});
+	cases.back().codec = static_cast<mtk::matfile::codec_t>(7);
+	cases.push_back({4});
+	cases.back().filter = static_cast<mtk::matfile::filter_t>(9);
+	cases.push_back({4});
+	cases.back().quantize = static_cast<mtk::matfile::quantize_t>(5);
+
+	std::printf("TEST >> unsupported options\n");
+	std::uint64_t num_failed = 0;
+	for (const auto& options : cases) {
+		std::remove(file_name.c_str());
+		try {
+			mtk::matfile::save_dense(100, 70, mat.data(), 100, file_name, mtk::matfile::op_t::no_transpose, options);
+			num_failed++;
+		} catch (const std::runtime_error& e) {
+			if (std::string(e.what()).find("Unsupported") == std::string::npos || std::filesystem::exists(file_name)) {
+				num_failed++;
+			}
+		}
+	}
+
+	if (num_failed == 0) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu cases\n", num_failed);
+		return 1;
+	}
+}
+
+int builtin_codec_test() {
+	std::mt19937 mt(std::random_device{}());
+	std::uniform_int_distribution<int> dist(0, 255);
+	std::uint64_t num_failed = 0;
+
+	for (std::size_t size = 0; size < 300; size++) {
+		for (const auto alphabet : std::vector<int>{1, 3, 256}) {
+			std::vector<char> src(size);
+			for (auto& v : src) {
+				v = static_cast<char>(dist(mt) % alphabet);
+			}
+			std::vector<char> compressed;
+			mtk::matfile::detail::builtin_compress(src.data(), src.size(), compressed);
+			std::vector<char> decompressed(size);
+			if (
+				!mtk::matfile::detail::builtin_decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()) ||
+				decompressed != src
+				) {
+				num_failed++;
+			}
+		}
+	}
+
+	std::printf("TEST >> builtin codec\n");
+	if (num_failed == 0) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. %lu cases\n", num_failed);
+		return 1;
+	}
+}
+
 int main() {
 	unsigned num_failed = 0;
 	unsigned num_tested = 0;
@@ -80,9 +1093,149 @@ int main() {
 				num_failed += standard_test<std::int16_t >(m, n, ld); num_tested++;
 				num_failed += standard_test<std::int32_t >(m, n, ld); num_tested++;
 				num_failed += standard_test<std::int64_t >(m, n, ld); num_tested++;
+
+				num_failed += standard_test<double       >(m, n, ld, {4}); num_tested++;
+				num_failed += standard_test<double       >(m, n, ld, {1, true}); num_tested++;
+				num_failed += standard_test<std::int8_t  >(m, n, ld, {1, true}); num_tested++;
+			}
+		}
+	}
+
+	for (const auto m : std::vector<std::uint64_t>{1, 100, 1000}) {
+		for (const auto n : std::vector<std::uint64_t>{1, 100, 3000}) {
+			for (const auto num_threads : std::vector<unsigned>{1, 4}) {
+				num_failed += transpose_test<double       , double      >(m, n, {num_threads}); num_tested++;
+				num_failed += transpose_test<double       , float       >(m, n, {num_threads}); num_tested++;
+				num_failed += transpose_test<float        , double      >(m, n, {num_threads}); num_tested++;
+				num_failed += transpose_test<float        , std::int32_t>(m, n, {num_threads}); num_tested++;
+				num_failed += transpose_test<std::uint8_t , std::uint8_t>(m, n, {num_threads}); num_tested++;
+				num_failed += transpose_test<std::int64_t , std::int16_t>(m, n, {num_threads}); num_tested++;
+			}
+			num_failed += transpose_test<double       , double      >(m, n, {1, true}); num_tested++;
+			num_failed += transpose_test<float        , double      >(m, n, {1, true}); num_tested++;
+		}
+	}
+
+	for (const auto m : std::vector<std::uint64_t>{1, 100, 1000}) {
+		for (const auto n : std::vector<std::uint64_t>{1, 100}) {
+			num_failed += mapped_test<double       >(m, n); num_tested++;
+			num_failed += mapped_test<float        >(m, n); num_tested++;
+			num_failed += mapped_test<std::int16_t >(m, n); num_tested++;
+		}
+	}
+	num_failed += mapped_overflow_test(); num_tested++;
+
+	for (const auto op : std::vector<mtk::matfile::op_t>{mtk::matfile::op_t::no_transpose, mtk::matfile::op_t::transpose}) {
+		for (const auto num_threads : std::vector<unsigned>{1, 4}) {
+			num_failed += block_test<double, double>(100, 200, 0 , 0 , 100, 200, op, num_threads); num_tested++;
+			num_failed += block_test<double, double>(100, 200, 0 , 50, 100, 30 , op, num_threads); num_tested++;
+			num_failed += block_test<double, double>(100, 200, 10, 50, 37 , 100, op, num_threads); num_tested++;
+			num_failed += block_test<float , double>(100, 200, 99, 0 , 1  , 200, op, num_threads); num_tested++;
+			num_failed += block_test<double, float >(100, 200, 10, 50, 37 , 100, op, num_threads); num_tested++;
+		}
+	}
+
+	for (const auto panel_width : std::vector<std::uint64_t>{1, 7, 100}) {
+		num_failed += writer_test<double, double      >(100, 100, panel_width); num_tested++;
+		num_failed += writer_test<double, float       >(100, 100, panel_width); num_tested++;
+		num_failed += writer_test<float , std::int16_t>(100, 100, panel_width); num_tested++;
+	}
+
+	for (const auto panel_width : std::vector<std::uint64_t>{1, 7, 100}) {
+		for (const auto prefetch : std::vector<bool>{false, true}) {
+			num_failed += reader_test<double, double>(100, 100, panel_width, prefetch); num_tested++;
+			num_failed += reader_test<double, float >(100, 100, panel_width, prefetch); num_tested++;
+		}
+	}
+
+	num_failed += async_test<double, double>(100, 100, 32); num_tested++;
+	num_failed += async_test<double, float >(100, 100, 32); num_tested++;
+#ifndef MATFILE_USE_OLD_FORMAT
+	{
+		mtk::matfile::io_options options;
+		options.codec = mtk::matfile::codec_t::builtin;
+		num_failed += async_test<double, double>(100, 100, 8, options); num_tested++;
+		options.codec = mtk::matfile::codec_t::none;
+		options.checksum = mtk::matfile::checksum_t::crc32c;
+		num_failed += async_test<double, double>(100, 100, 8, options); num_tested++;
+	}
+#endif
+
+	for (const auto op : std::vector<mtk::matfile::op_t>{mtk::matfile::op_t::no_transpose, mtk::matfile::op_t::transpose}) {
+		for (const auto convert : std::vector<mtk::matfile::convert_t>{mtk::matfile::convert_t::saturate, mtk::matfile::convert_t::round_saturate}) {
+			for (const auto num_threads : std::vector<unsigned>{1, 4}) {
+				num_failed += convert_test<double      , std::int8_t  >(100, 70, op, convert, num_threads); num_tested++;
+				num_failed += convert_test<double      , std::uint8_t >(100, 70, op, convert, num_threads); num_tested++;
+				num_failed += convert_test<float       , std::int32_t >(100, 70, op, convert, num_threads); num_tested++;
+				num_failed += convert_test<double      , std::uint64_t>(100, 70, op, convert, num_threads); num_tested++;
+				num_failed += convert_test<std::int32_t, std::int16_t >(100, 70, op, convert, num_threads); num_tested++;
+				num_failed += convert_test<std::int64_t, std::uint32_t>(100, 70, op, convert, num_threads); num_tested++;
+				num_failed += convert_test<std::uint16_t, std::int8_t >(100, 70, op, convert, num_threads); num_tested++;
+			}
+		}
+	}
+
+	num_failed += fp16_roundtrip_test<mtk::matfile::half    >(); num_tested++;
+	num_failed += fp16_roundtrip_test<mtk::matfile::bfloat16>(); num_tested++;
+	for (const auto op : std::vector<mtk::matfile::op_t>{mtk::matfile::op_t::no_transpose, mtk::matfile::op_t::transpose}) {
+		for (const auto num_threads : std::vector<unsigned>{1, 4}) {
+			num_failed += fp16_test<float , mtk::matfile::half    >(100, 70, op, {num_threads}); num_tested++;
+			num_failed += fp16_test<double, mtk::matfile::half    >(100, 70, op, {num_threads}); num_tested++;
+			num_failed += fp16_test<float , mtk::matfile::bfloat16>(100, 70, op, {num_threads}); num_tested++;
+			num_failed += fp16_test<double, mtk::matfile::bfloat16>(100, 70, op, {num_threads}); num_tested++;
+		}
+		num_failed += fp16_test<float , mtk::matfile::half    >(100, 70, op, {1, true}); num_tested++;
+	}
+
+#ifndef MATFILE_USE_OLD_FORMAT
+	num_failed += legacy_header_test(); num_tested++;
+#endif
+	num_failed += index_test(1); num_tested++;
+	num_failed += index_test(4); num_tested++;
+
+	num_failed += builtin_codec_test(); num_tested++;
+#ifndef MATFILE_USE_OLD_FORMAT
+	num_failed += unsupported_options_test(); num_tested++;
+	// Compressed payloads require the versioned header
+	for (const auto op : std::vector<mtk::matfile::op_t>{mtk::matfile::op_t::no_transpose, mtk::matfile::op_t::transpose}) {
+		for (const auto num_threads : std::vector<unsigned>{1, 4}) {
+			for (const auto chunk_cols : std::vector<std::uint64_t>{0, 1, 13}) {
+				num_failed += codec_test<double      , double      >(100, 200, chunk_cols, op, num_threads); num_tested++;
+				num_failed += codec_test<float       , double      >(300, 50 , chunk_cols, op, num_threads); num_tested++;
+				num_failed += codec_test<std::int32_t, std::int8_t >(100, 200, chunk_cols, op, num_threads); num_tested++;
+				for (const auto filter : std::vector<mtk::matfile::filter_t>{mtk::matfile::filter_t::shuffle, mtk::matfile::filter_t::xor_shuffle}) {
+					num_failed += codec_test<double      , double      >(100, 200, chunk_cols, op, num_threads, filter); num_tested++;
+					num_failed += codec_test<float       , float       >(300, 50 , chunk_cols, op, num_threads, filter); num_tested++;
+					num_failed += codec_test<long double , long double >(100, 20 , chunk_cols, op, num_threads, filter); num_tested++;
+					num_failed += codec_test<std::int32_t, std::int16_t>(100, 200, chunk_cols, op, num_threads, filter); num_tested++;
+				}
+			}
+			// direct_io loads of chunked payloads
+			num_failed += codec_test<double      , double      >(100, 200, 13, op, num_threads, mtk::matfile::filter_t::none   , true); num_tested++;
+			num_failed += codec_test<float       , float       >(300, 50 , 13, op, num_threads, mtk::matfile::filter_t::shuffle, true); num_tested++;
+		}
+	}
+	for (const auto quantize : std::vector<mtk::matfile::quantize_t>{mtk::matfile::quantize_t::int8, mtk::matfile::quantize_t::int4}) {
+		for (const auto block : std::vector<std::uint64_t>{0, 37}) {
+			for (const auto stochastic : std::vector<bool>{false, true}) {
+				num_failed += quantize_test<float >(300, 50, quantize, block, stochastic, mtk::matfile::codec_t::none, 1); num_tested++;
+				num_failed += quantize_test<double>(301, 50, quantize, block, stochastic, mtk::matfile::codec_t::builtin, 4); num_tested++;
+			}
+		}
+	}
+	for (const auto op : std::vector<mtk::matfile::op_t>{mtk::matfile::op_t::no_transpose, mtk::matfile::op_t::transpose}) {
+		for (const auto num_threads : std::vector<unsigned>{1, 4}) {
+			for (const auto padding : std::vector<std::uint64_t>{0, 5}) {
+				num_failed += checksum_test<double, double>(100, 200, 0 , padding, mtk::matfile::codec_t::none   , op, num_threads); num_tested++;
+				num_failed += checksum_test<double, double>(100, 200, 13, padding, mtk::matfile::codec_t::none   , op, num_threads); num_tested++;
+				num_failed += checksum_test<float , double>(100, 200, 13, padding, mtk::matfile::codec_t::none   , op, num_threads); num_tested++;
+				num_failed += checksum_test<double, double>(100, 200, 13, padding, mtk::matfile::codec_t::builtin, op, num_threads); num_tested++;
 			}
+			num_failed += checksum_test<double, double>(100, 200, 13, 5, mtk::matfile::codec_t::none   , op, num_threads, true); num_tested++;
+			num_failed += checksum_test<double, double>(100, 200, 13, 5, mtk::matfile::codec_t::builtin, op, num_threads, true); num_tested++;
 		}
 	}
+#endif
 
 	std::printf("[TEST RESULT] %5u / %5u PASSED\n", (num_tested - num_failed), num_tested);
 }
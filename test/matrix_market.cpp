@@ -1,12 +1,99 @@
 #include <memory>
 #include <cmath>
 #include <iostream>
+#include <fstream>
+#include <vector>
+#include <complex>
 #include <matfile/matfile.hpp>
 
+template <class T>
+bool variant_test(const std::string name, const std::string text, const std::vector<T>& expected, const unsigned num_threads = 0) {
+	const std::string tmp_name = "matrix_market_test.mtx";
+	{
+		std::ofstream ofs(tmp_name);
+		ofs << text;
+	}
+	const auto [m, n] = mtk::matfile::matrix_market::load_matrix_size(tmp_name);
+	std::vector<T> mat(m * n);
+	bool ok;
+	try {
+		mtk::matfile::matrix_market::load_matrix(mat.data(), m, tmp_name, true, num_threads);
+		ok = mat == expected;
+	} catch (const std::exception&) {
+		// An empty expectation means the file must be rejected
+		ok = expected.empty();
+	}
+	std::remove(tmp_name.c_str());
+	std::printf("[%s] %s\n", ok ? " OK " : "NG", name.c_str());
+	return ok;
+}
+
+void variant_tests() {
+	using c64 = std::complex<double>;
+	variant_test<double>("array real general",
+		"%%MatrixMarket matrix array real general\n2 3\n1\n2\n3\n4\n5\n6\n",
+		{1, 2, 3, 4, 5, 6});
+	variant_test<double>("array real symmetric",
+		"%%MatrixMarket matrix array real symmetric\n% comment\n3 3\n1\n2\n3\n4\n5\n6\n",
+		{1, 2, 3, 2, 4, 5, 3, 5, 6});
+	variant_test<float>("array real skew-symmetric",
+		"%%MatrixMarket matrix array real skew-symmetric\n3 3\n1\n2\n3\n",
+		{0, 1, 2, -1, 0, 3, -2, -3, 0});
+	variant_test<std::int64_t>("coordinate integer general",
+		"%%MatrixMarket matrix coordinate integer general\n2 2 2\n1 1 9007199254740993\n2 1 -7\n",
+		{9007199254740993, -7, 0, 0});
+	variant_test<c64>("coordinate complex hermitian",
+		"%%MatrixMarket matrix coordinate complex hermitian\n2 2 2\n1 1 1 0\n2 1 2 3\n",
+		{c64(1, 0), c64(2, 3), c64(2, -3), c64(0, 0)});
+	variant_test<std::complex<float>>("array complex general",
+		"%%MatrixMarket matrix array complex general\n1 2\n1 -1\n+2.5 0.5\n",
+		{std::complex<float>(1, -1), std::complex<float>(2.5, 0.5)});
+	variant_test<double>("upper case banner",
+		"%%MatrixMarket MATRIX Coordinate Real General\n1 1 1\n1 1 3\n",
+		{3});
+	variant_test<double>("complex into real type",
+		"%%MatrixMarket matrix coordinate complex general\n1 1 1\n1 1 3 4\n",
+		{});
+	variant_test<double>("unsupported element type",
+		"%%MatrixMarket matrix coordinate quaternion general\n1 1 1\n1 1 3\n",
+		{});
+	variant_test<double>("truncated array",
+		"%%MatrixMarket matrix array real general\n2 2\n1\n2\n3\n",
+		{});
+
+	// Parallel array parsing must keep the positions across the thread boundaries
+	std::string text = "%%MatrixMarket matrix array real symmetric\n101 101\n";
+	std::vector<double> expected(101 * 101);
+	double v = 0;
+	for (std::size_t j = 0; j < 101; j++) {
+		for (std::size_t i = j; i < 101; i++) {
+			text += std::to_string(++v) + "\n";
+			expected[i + j * 101] = expected[j + i * 101] = v;
+		}
+	}
+	variant_test<double>("array real symmetric (4 threads)", text, expected, 4);
+
+	// Duplicate coordinates keep the last entry even when they are parsed by different threads
+	variant_test<double>("coordinate duplicates",
+		"%%MatrixMarket matrix coordinate real general\n2 1 3\n1 1 1\n2 1 2\n1 1 3\n",
+		{3, 2});
+	text = "%%MatrixMarket matrix coordinate real symmetric\n8 8 2000\n";
+	expected.assign(8 * 8, 0);
+	std::uint32_t seed = 1;
+	for (std::size_t k = 1; k <= 2000; k++) {
+		seed = seed * 1664525u + 1013904223u;
+		const std::size_t j = (seed >> 8) % 8;
+		const std::size_t i = j + (seed >> 16) % (8 - j);
+		text += std::to_string(i + 1) + " " + std::to_string(j + 1) + " " + std::to_string(k) + "\n";
+		expected[i + j * 8] = expected[j + i * 8] = k;
+	}
+	variant_test<double>("coordinate real symmetric duplicates (4 threads)", text, expected, 4);
+}
+
 int main(int argc, char** argv) {
+	variant_tests();
 	if (argc < 2) {
-		std::fprintf(stderr, "Usage : %s /path/to/matrix.mtx\n", argv[0]);
-		return 1;
+		return 0;
 	}
 
 	const auto [m, n] = mtk::matfile::matrix_market::load_matrix_size(argv[1]);
@@ -29,4 +116,48 @@ int main(int argc, char** argv) {
 							m, n,
 							std::sqrt(sum)
 							);
+
+	// The sparse loaders must give the same norm as the dense loader
+	const auto csr = mtk::matfile::matrix_market::load_csr<float, std::uint32_t>(argv[1]);
+	const auto csc = mtk::matfile::matrix_market::load_csc<float>(argv[1]);
+	const auto coo = mtk::matfile::matrix_market::load_coo<float>(argv[1], true, true);
+	double csr_sum = 0, csc_sum = 0, coo_sum = 0;
+	bool sorted = true;
+	for (std::size_t i = 0; i < csr.m; i++) {
+		for (auto k = csr.row_ptr[i]; k < csr.row_ptr[i + 1]; k++) {
+			csr_sum += csr.values[k] * csr.values[k];
+			sorted &= k == csr.row_ptr[i] || csr.col_index[k - 1] < csr.col_index[k];
+		}
+	}
+	for (std::size_t j = 0; j < csc.n; j++) {
+		for (auto k = csc.col_ptr[j]; k < csc.col_ptr[j + 1]; k++) {
+			csc_sum += csc.values[k] * csc.values[k];
+			sorted &= k == csc.col_ptr[j] || csc.row_index[k - 1] < csc.row_index[k];
+		}
+	}
+	for (std::size_t k = 0; k < coo.nnz(); k++) {
+		coo_sum += coo.values[k] * coo.values[k];
+		sorted &= k == 0 || coo.row_index[k - 1] < coo.row_index[k] || (coo.row_index[k - 1] == coo.row_index[k] && coo.col_index[k - 1] < coo.col_index[k]);
+	}
+	const auto check = [&](const char* const name, const double s, const std::size_t nnz) {
+		const auto ok = std::abs(std::sqrt(s) - std::sqrt(sum)) <= 1e-5 * std::sqrt(sum);
+		std::printf("[%s] %s l2 norm = %e, nnz = %lu\n", ok ? " OK " : "NG", name, std::sqrt(s), nnz);
+	};
+	check("CSR", csr_sum, csr.nnz());
+	check("CSC", csc_sum, csc.nnz());
+	check("COO", coo_sum, coo.nnz());
+	std::printf("[%s] sorted\n", sorted ? " OK " : "NG");
+
+	// Round trip through the writer
+	const std::string tmp_name = "matrix_market_test.mtx";
+	mtk::matfile::matrix_market::save_csr(csr, tmp_name);
+	const auto reloaded_csr = mtk::matfile::matrix_market::load_csr<float, std::uint32_t>(tmp_name);
+	mtk::matfile::matrix_market::save_matrix(m, n, mat_uptr.get(), m, tmp_name);
+	std::unique_ptr<float[]> reloaded_mat_uptr(new float[m * n]);
+	mtk::matfile::matrix_market::load_matrix(reloaded_mat_uptr.get(), m, tmp_name);
+	std::remove(tmp_name.c_str());
+	const auto csr_ok = reloaded_csr.row_ptr == csr.row_ptr && reloaded_csr.col_index == csr.col_index && reloaded_csr.values == csr.values;
+	const auto dense_ok = std::equal(mat_uptr.get(), mat_uptr.get() + m * n, reloaded_mat_uptr.get());
+	std::printf("[%s] CSR round trip\n", csr_ok ? " OK " : "NG");
+	std::printf("[%s] dense round trip\n", dense_ok ? " OK " : "NG");
 }
@@ -0,0 +1,156 @@
+#include <iostream>
+#include <memory>
+#include <random>
+#include <limits>
+#include <cstdio>
+#include <fstream>
+#include <matfile/matfile.hpp>
+
+template <class T, class INDEX_T>
+mtk::matfile::coo_matrix<T, INDEX_T> make_random_coo(const std::uint64_t m, const std::uint64_t n, const std::uint64_t nnz) {
+	std::uniform_real_distribution<double> dist(-10, 10);
+	std::uniform_int_distribution<std::uint64_t> row_dist(0, m - 1);
+	std::uniform_int_distribution<std::uint64_t> col_dist(0, n - 1);
+	std::mt19937 mt(std::random_device{}());
+
+	mtk::matfile::coo_matrix<T, INDEX_T> coo;
+	coo.m = m;
+	coo.n = n;
+	for (std::uint64_t k = 0; k < nnz; k++) {
+		coo.row_index.push_back(row_dist(mt));
+		coo.col_index.push_back(col_dist(mt));
+		coo.values.push_back(dist(mt));
+	}
+	return coo;
+}
+
+template <class T, class MATFILE_T, class INDEX_T, class LOAD_INDEX_T>
+int csr_test(const std::uint64_t m, const std::uint64_t n, const std::uint64_t nnz, const unsigned num_threads) {
+	const std::string file_name = "sparse_test.matrix";
+	const auto csr = mtk::matfile::to_csr(make_random_coo<T, INDEX_T>(m, n, nnz));
+
+	mtk::matfile::save_csr<T, MATFILE_T>(csr, file_name);
+	const auto load_csr = mtk::matfile::load_csr<T, LOAD_INDEX_T>(file_name, {num_threads});
+
+	std::printf("TEST >> CSR, shape = (%lu, %lu), nnz = %lu, dtype = %s -> %s, index = %s -> %s, threads = %u\n",
+							load_csr.m, load_csr.n, load_csr.nnz(),
+							mtk::matfile::detail::get_type_name_str<T>().c_str(),
+							mtk::matfile::detail::get_type_name_str<MATFILE_T>().c_str(),
+							mtk::matfile::detail::get_type_name_str<INDEX_T>().c_str(),
+							mtk::matfile::detail::get_type_name_str<LOAD_INDEX_T>().c_str(),
+							num_threads
+						 );
+
+	bool ok = load_csr.m == m && load_csr.n == n && load_csr.nnz() == csr.nnz();
+	for (std::uint64_t i = 0; ok && i <= m; i++) {
+		ok = static_cast<std::uint64_t>(load_csr.row_ptr[i]) == static_cast<std::uint64_t>(csr.row_ptr[i]);
+	}
+	double error = 0;
+	for (std::uint64_t k = 0; ok && k < csr.nnz(); k++) {
+		ok = static_cast<std::uint64_t>(load_csr.col_index[k]) == static_cast<std::uint64_t>(csr.col_index[k]);
+		error = std::max(std::abs(static_cast<double>(load_csr.values[k]) - static_cast<double>(static_cast<MATFILE_T>(csr.values[k]))), error);
+	}
+
+	if (ok && error == 0) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. structure = %s, error = %e\n", ok ? "OK" : "NG", error);
+		return 1;
+	}
+}
+
+template <class T, class INDEX_T>
+int mapped_csc_test(const std::uint64_t m, const std::uint64_t n, const std::uint64_t nnz) {
+	const std::string file_name = "sparse_test.matrix";
+	const auto coo = make_random_coo<T, INDEX_T>(m, n, nnz);
+	const auto csc = mtk::matfile::to_csc(coo);
+	mtk::matfile::save_csc(csc, file_name);
+
+	const mtk::matfile::mapped_csc<T, INDEX_T> mapped(file_name);
+	std::printf("TEST >> mapped CSC, shape = (%lu, %lu), nnz = %lu, dtype = %s, index = %s\n",
+							mapped.m(), mapped.n(), mapped.nnz(),
+							mtk::matfile::detail::get_type_name_str<T>().c_str(),
+							mtk::matfile::detail::get_type_name_str<INDEX_T>().c_str()
+						 );
+
+	// Sum of A * 1 computed from the mapping and from the COO
+	std::vector<double> y(m, 0), y_ref(m, 0), abs_sum(m, 0);
+	std::vector<std::uint64_t> count(m, 0);
+	for (std::uint64_t j = 0; j < n; j++) {
+		for (auto k = mapped.ptr()[j]; k < mapped.ptr()[j + 1]; k++) {
+			y[mapped.index()[k]] += mapped.values()[k];
+		}
+	}
+	for (std::uint64_t k = 0; k < coo.nnz(); k++) {
+		y_ref[coo.row_index[k]] += coo.values[k];
+		abs_sum[coo.row_index[k]] += std::abs(static_cast<double>(coo.values[k]));
+		count[coo.row_index[k]]++;
+	}
+
+	// Duplicates are summed in T and the rows are summed in a different order, so the bound grows with the number of entries in the row
+	bool ok = mapped.nnz() == csc.nnz();
+	for (std::uint64_t i = 0; ok && i < m; i++) {
+		const auto error = std::abs(y[i] - y_ref[i]);
+		const auto error_threshold = std::numeric_limits<T>::epsilon() * count[i] * abs_sum[i];
+		if (error > error_threshold) {
+			std::printf("<< FAILED. The error (%e) of the row %lu is larger than %e\n", error, i, error_threshold);
+			return 1;
+		}
+	}
+	if (ok) {
+		std::printf("<< PASSED\n");
+		return 0;
+	} else {
+		std::printf("<< FAILED. nnz = %lu, expected %lu\n", mapped.nnz(), csc.nnz());
+		return 1;
+	}
+}
+
+// A corrupted nnz whose array sizes overflow must not pass the size check
+int mapped_overflow_test() {
+	const std::string file_name = "sparse_test.matrix";
+	const auto csc = mtk::matfile::to_csc(make_random_coo<double, std::uint32_t>(10, 10, 20));
+	mtk::matfile::save_csc(csc, file_name);
+	auto header = mtk::matfile::load_header(file_name);
+	header.a0 = 1lu << 62;
+	{
+		std::fstream fs(file_name, std::ios::binary | std::ios::in | std::ios::out);
+		fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	}
+	std::printf("TEST >> mapped CSC overflow, nnz = %lu\n", header.a0);
+
+	try {
+		const mtk::matfile::mapped_csc<double, std::uint32_t> mapped(file_name);
+	} catch (const std::runtime_error& e) {
+		if (std::string(e.what()).find("Truncated file") != std::string::npos) {
+			std::printf("<< PASSED\n");
+			return 0;
+		}
+	}
+	std::printf("<< FAILED\n");
+	return 1;
+}
+
+int main() {
+	unsigned num_failed = 0;
+	unsigned num_tested = 0;
+	for (const auto m : std::vector<std::uint64_t>{1, 100, 1000}) {
+		for (const auto n : std::vector<std::uint64_t>{1, 100, 3000}) {
+			for (const auto nnz : std::vector<std::uint64_t>{0, 10, 10000}) {
+				for (const auto num_threads : std::vector<unsigned>{1, 4}) {
+					num_failed += csr_test<double      , double      , std::uint64_t, std::uint64_t>(m, n, nnz, num_threads); num_tested++;
+					num_failed += csr_test<double      , float       , std::uint32_t, std::uint64_t>(m, n, nnz, num_threads); num_tested++;
+					num_failed += csr_test<float       , float       , std::uint64_t, std::int32_t >(m, n, nnz, num_threads); num_tested++;
+					num_failed += csr_test<std::int32_t, std::int8_t , std::uint32_t, std::uint32_t>(m, n, nnz, num_threads); num_tested++;
+				}
+				num_failed += mapped_csc_test<double, std::uint32_t>(m, n, nnz); num_tested++;
+				num_failed += mapped_csc_test<float , std::uint32_t>(m, n, nnz); num_tested++;
+			}
+		}
+	}
+
+	num_failed += mapped_overflow_test(); num_tested++;
+
+	std::printf("[TEST RESULT] %5u / %5u PASSED\n", (num_tested - num_failed), num_tested);
+}
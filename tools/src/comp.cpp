@@ -2,6 +2,10 @@
 #include <iostream>
 #include <memory>
 #include <cmath>
+#include <algorithm>
+
+// Panel size of each matrix read at once
+constexpr std::size_t panel_size = 1lu << 26;
 
 template <class T, class S>
 void comp(
@@ -10,23 +14,28 @@ void comp(
 	const std::size_t m,
 	const std::size_t n
 	) {
-	std::unique_ptr<T[]> matrix_A(new T [m * n]);
-	std::unique_ptr<S[]> matrix_B(new S [m * n]);
-
-	mtk::matfile::load_dense(matrix_A.get(), m, matrix_A_path);
-	mtk::matfile::load_dense(matrix_B.get(), m, matrix_B_path);
-
-	const T* const matrix_A_ptr = matrix_A.get();
-	const S* const matrix_B_ptr = matrix_B.get();
+	const auto panel_width = std::max<std::size_t>(1, std::min<std::size_t>(n, panel_size / (std::max<std::size_t>(1, m) * std::max(sizeof(T), sizeof(S)))));
+	mtk::matfile::dense_reader<T> matrix_A(matrix_A_path, panel_width, true);
+	mtk::matfile::dense_reader<S> matrix_B(matrix_B_path, panel_width, true);
 
 	long double base_norm2 = 0;
 	long double diff_norm2 = 0;
 	long double max_error = 0;
-#pragma omp parallel for reduction(+: base_norm2) reduction(+: diff_norm2) reduction(max: max_error) collapse(2)
-	for (std::size_t im = 0; im < m; im++) {
-		for (std::size_t in = 0; in < n; in++) {
-			const long double base = matrix_A_ptr[im + in * n];
-			const long double diff = matrix_A_ptr[im + in * n] - matrix_B_ptr[im + in * m];
+	std::size_t num_cols;
+	std::size_t num_read_cols = 0;
+	while ((num_cols = matrix_A.next_panel()) != 0) {
+		if (matrix_B.next_panel() != num_cols || num_read_cols + num_cols > n) {
+			std::printf("Failed to read the matrices at column %lu\n", num_read_cols);
+			return;
+		}
+		num_read_cols += num_cols;
+		const T* const matrix_A_ptr = matrix_A.panel_data();
+		const S* const matrix_B_ptr = matrix_B.panel_data();
+
+MATFILE_OMP(omp parallel for reduction(+: base_norm2) reduction(+: diff_norm2) reduction(max: max_error))
+		for (std::size_t i = 0; i < m * num_cols; i++) {
+			const long double base = matrix_A_ptr[i];
+			const long double diff = matrix_A_ptr[i] - matrix_B_ptr[i];
 
 			base_norm2 += base * base;
 			diff_norm2 += diff * diff;
@@ -0,0 +1,148 @@
+#include <matfile/matfile.hpp>
+#include <iostream>
+#include <memory>
+#include <filesystem>
+#include <vector>
+#include <string>
+
+namespace fs = std::filesystem;
+
+enum class format_t {
+	dense,
+	csr,
+	csc
+};
+
+template <class T>
+void mtx_to_matfile(
+	const std::string src,
+	const std::string dst,
+	const format_t format,
+	const unsigned num_threads
+	) {
+	if (format == format_t::dense) {
+		const auto [m, n] = mtk::matfile::matrix_market::load_matrix_size(src);
+		std::unique_ptr<T[]> mat_uptr(new T[m * n]);
+		mtk::matfile::matrix_market::load_matrix(mat_uptr.get(), m, src, true, num_threads);
+		mtk::matfile::save_dense(m, n, mat_uptr.get(), m, dst, mtk::matfile::op_t::no_transpose, {num_threads});
+	} else if (format == format_t::csr) {
+		mtk::matfile::save_csr(mtk::matfile::matrix_market::load_csr<T>(src, true, true, num_threads), dst);
+	} else {
+		mtk::matfile::save_csc(mtk::matfile::matrix_market::load_csc<T>(src, true, true, num_threads), dst);
+	}
+}
+
+void matfile_to_mtx(
+	const std::string src,
+	const std::string dst,
+	const unsigned num_threads
+	) {
+	const auto header = mtk::matfile::load_header(src);
+	mtk::matfile::detail::dispatch_data_type(header.data_type, [&](const auto tag) {
+		using T = typename decltype(tag)::type;
+		if (header.matrix_type == mtk::matfile::matrix_t::csr) {
+			mtk::matfile::matrix_market::save_csr(mtk::matfile::load_csr<T>(src, {num_threads}), dst, num_threads);
+		} else if (header.matrix_type == mtk::matfile::matrix_t::csc) {
+			mtk::matfile::matrix_market::save_csc(mtk::matfile::load_csc<T>(src, {num_threads}), dst, num_threads);
+		} else {
+			std::unique_ptr<T[]> mat_uptr(new T[header.m * header.n]);
+			mtk::matfile::load_dense(mat_uptr.get(), header.m, src, mtk::matfile::op_t::no_transpose, {num_threads});
+			mtk::matfile::matrix_market::save_matrix(header.m, header.n, mat_uptr.get(), header.m, dst, num_threads);
+		}
+	});
+}
+
+void convert(
+	const fs::path src,
+	const fs::path dst,
+	const format_t format,
+	const bool fp32,
+	const unsigned num_threads
+	) {
+	if (src.extension() == ".mtx") {
+		if (fp32) {
+			mtx_to_matfile<float >(src.string(), dst.string(), format, num_threads);
+		} else {
+			mtx_to_matfile<double>(src.string(), dst.string(), format, num_threads);
+		}
+	} else {
+		matfile_to_mtx(src.string(), dst.string(), num_threads);
+	}
+}
+
+void print_usage(const char* const name) {
+	std::fprintf(stderr, "Usage: %s [--format dense|csr|csc] [--dtype fp32|fp64] [--threads N] [input] [output]\n", name);
+	std::fprintf(stderr, "  *.mtx is converted to a matfile and the others to *.mtx.\n");
+	std::fprintf(stderr, "  When the input is a directory, *.mtx and *.matrix in it are converted in parallel into the output directory.\n");
+}
+
+int main(int argc, char** argv) {
+	format_t format = format_t::csr;
+	bool fp32 = false;
+	unsigned num_threads = 0;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "--format" && i + 1 < argc) {
+			const std::string v = argv[++i];
+			if (v == "dense") {format = format_t::dense;}
+			else if (v == "csr") {format = format_t::csr;}
+			else if (v == "csc") {format = format_t::csc;}
+			else {print_usage(argv[0]); return 1;}
+		} else if (arg == "--dtype" && i + 1 < argc) {
+			const std::string v = argv[++i];
+			if (v == "fp32") {fp32 = true;}
+			else if (v == "fp64") {fp32 = false;}
+			else {print_usage(argv[0]); return 1;}
+		} else if (arg == "--threads" && i + 1 < argc) {
+			num_threads = std::stoul(argv[++i]);
+		} else {
+			paths.push_back(arg);
+		}
+	}
+	if (paths.size() != 2) {
+		print_usage(argv[0]);
+		return 1;
+	}
+	const fs::path src = paths[0];
+	const fs::path dst = paths[1];
+
+	if (!fs::is_directory(src)) {
+		try {
+			convert(src, dst, format, fp32, num_threads);
+		} catch (const std::exception& e) {
+			std::fprintf(stderr, "%s\n", e.what());
+			return 1;
+		}
+		return 0;
+	}
+
+	fs::create_directories(dst);
+	std::vector<std::pair<fs::path, fs::path>> jobs;
+	for (const auto& entry : fs::directory_iterator(src)) {
+		const auto& path = entry.path();
+		if (!entry.is_regular_file()) {
+			continue;
+		}
+		if (path.extension() == ".mtx") {
+			jobs.push_back({path, dst / path.filename().replace_extension(".matrix")});
+		} else if (path.extension() == ".matrix") {
+			jobs.push_back({path, dst / path.filename().replace_extension(".mtx")});
+		}
+	}
+
+	// One file per thread. Each conversion runs on a single thread.
+	unsigned num_failed = 0;
+MATFILE_OMP(omp parallel for schedule(dynamic, 1) reduction(+: num_failed) num_threads(mtk::matfile::matrix_market::detail::get_num_threads(num_threads)))
+	for (std::size_t i = 0; i < jobs.size(); i++) {
+		try {
+			convert(jobs[i].first, jobs[i].second, format, fp32, 1);
+			std::printf("%s -> %s\n", jobs[i].first.c_str(), jobs[i].second.c_str());
+		} catch (const std::exception& e) {
+			std::fprintf(stderr, "%s : %s\n", jobs[i].first.c_str(), e.what());
+			num_failed++;
+		}
+	}
+	std::printf("%lu / %lu converted\n", jobs.size() - num_failed, jobs.size());
+	return num_failed == 0 ? 0 : 1;
+}
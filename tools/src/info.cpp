@@ -1,5 +1,8 @@
 #include <iostream>
 #include <memory>
+#include <filesystem>
+#include <vector>
+#include <string>
 #include <matfile/matfile.hpp>
 #include <fphistogram/fphistogram.hpp>
 
@@ -20,18 +23,107 @@ void print_info(
 	mtk::fphistogram::print_histogram_pm(mat_uptr.get(), m * n);
 }
 
+void print_entry(
+	const mtk::matfile::index_entry& entry
+	) {
+	const char* const format = entry.matrix_type == mtk::matfile::matrix_t::dense ? "dense" : (entry.matrix_type == mtk::matfile::matrix_t::csr ? "csr" : "csc");
+	std::printf("%s\t%lu x %lu\t%s\t%s%s\n",
+		entry.path.c_str(),
+		entry.m, entry.n,
+		mtk::matfile::detail::get_data_type_str(entry.data_type).c_str(),
+		format,
+		entry.checksum == mtk::matfile::checksum_t::crc32c ? "\tcrc32c" : ""
+		);
+}
+
+// Print one line per file from the headers only.
+// With an index, only the files which changed since the last run are read and no file is read when no path is given.
+int print_headers(
+	const std::vector<std::string>& paths,
+	const std::string index_path,
+	const unsigned num_threads
+	) {
+	std::vector<std::string> files;
+	for (const auto& path : paths) {
+		if (!std::filesystem::is_directory(path)) {
+			files.push_back(path);
+			continue;
+		}
+		for (const auto& entry : std::filesystem::directory_iterator(path)) {
+			if (entry.is_regular_file() && entry.path().extension() == ".matrix") {
+				files.push_back(entry.path().string());
+			}
+		}
+	}
+
+	try {
+		if (!index_path.empty()) {
+			const auto entries = files.empty() ? mtk::matfile::load_index(index_path) : mtk::matfile::update_index(index_path, files, num_threads);
+			for (const auto& entry : entries) {
+				print_entry(entry);
+			}
+			return 0;
+		}
+		const auto headers = mtk::matfile::load_headers(files, num_threads);
+		for (std::size_t i = 0; i < files.size(); i++) {
+			mtk::matfile::index_entry entry;
+			entry.path = files[i];
+			entry.matrix_type = headers[i].matrix_type;
+			entry.data_type = headers[i].data_type;
+			entry.m = headers[i].m;
+			entry.n = headers[i].n;
+			entry.checksum = headers[i].matrix_type == mtk::matfile::matrix_t::dense ? mtk::matfile::detail::get_checksum(headers[i]) : mtk::matfile::checksum_t::none;
+			print_entry(entry);
+		}
+	} catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
+
+void print_usage(const char* const name) {
+	std::fprintf(stderr, "Usage: %s [--header-only [--index FILE] [--threads N]] [matfile or directory]...\n", name);
+	std::fprintf(stderr, "  --header-only : print the path, shape, dtype and format of each file without loading the matrices\n");
+	std::fprintf(stderr, "  --index FILE  : keep the headers in FILE and read only the files changed since the last run.\n");
+	std::fprintf(stderr, "                  Without paths, the files in the index are listed without being touched.\n");
+}
+
 int main(
 	int argc,
 	char** argv
 	) {
-	if (argc <= 1) {
-		std::fprintf(stderr, "Usage %s: [matfile path list]\n", argv[0]);
+	bool header_only = false;
+	std::string index_path;
+	unsigned num_threads = 0;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "--header-only") {
+			header_only = true;
+		} else if (arg == "--index" && i + 1 < argc) {
+			index_path = argv[++i];
+		} else if (arg == "--threads" && i + 1 < argc) {
+			num_threads = std::stoul(argv[++i]);
+		} else {
+			paths.push_back(arg);
+		}
+	}
+	if (header_only) {
+		if (paths.empty() && index_path.empty()) {
+			print_usage(argv[0]);
+			return 1;
+		}
+		return print_headers(paths, index_path, mtk::matfile::matrix_market::detail::get_num_threads(num_threads));
+	}
+	if (paths.empty()) {
+		print_usage(argv[0]);
 		return 1;
 	}
 
-	for (int i = 1; i < argc; i++) {
-		const auto matfile_path = std::string(argv[i]);
-		std::printf("## ---- [%d] path : %s ----\n", i, matfile_path.c_str());
+	for (std::size_t i = 0; i < paths.size(); i++) {
+		const auto matfile_path = paths[i];
+		std::printf("## ---- [%lu] path : %s ----\n", i + 1, matfile_path.c_str());
 
 		const auto dtype = mtk::matfile::load_dtype(matfile_path);
 		if (dtype == mtk::matfile::data_t::fp32) {
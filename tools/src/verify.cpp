@@ -0,0 +1,100 @@
+#include <matfile/matfile.hpp>
+#include <iostream>
+#include <filesystem>
+#include <vector>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// Files without a checksum (legacy dense, CSR/CSC) cannot be verified
+bool has_checksum(
+	const std::string path
+	) {
+	const auto header = mtk::matfile::load_header(path);
+	return header.matrix_type == mtk::matfile::matrix_t::dense && mtk::matfile::detail::get_checksum(header) != mtk::matfile::checksum_t::none;
+}
+
+// Returns an empty string when the file is intact
+std::string verify(
+	const std::string path,
+	const unsigned num_threads
+	) {
+	const auto corrupted = mtk::matfile::verify_dense(path, num_threads);
+	if (corrupted.empty()) {
+		return "";
+	}
+	const auto header = mtk::matfile::load_header(path);
+	std::string message = std::to_string(corrupted.size()) + " corrupted chunk(s), columns";
+	for (const auto c : corrupted) {
+		message += " [" + std::to_string(c * header.a1) + ", " + std::to_string(std::min((c + 1) * header.a1, header.n)) + ")";
+	}
+	return message;
+}
+
+void print_usage(const char* const name) {
+	std::fprintf(stderr, "Usage: %s [--threads N] [file or directory]...\n", name);
+	std::fprintf(stderr, "  Verifies the checksums of dense matfiles saved with io_options::checksum.\n");
+	std::fprintf(stderr, "  *.matrix in the given directories are verified in parallel.\n");
+}
+
+int main(int argc, char** argv) {
+	unsigned num_threads = 0;
+	std::vector<fs::path> paths;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc) {
+			num_threads = std::stoul(argv[++i]);
+		} else {
+			paths.push_back(arg);
+		}
+	}
+	if (paths.empty()) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<fs::path> files;
+	for (const auto& path : paths) {
+		if (!fs::is_directory(path)) {
+			files.push_back(path);
+			continue;
+		}
+		for (const auto& entry : fs::directory_iterator(path)) {
+			if (entry.is_regular_file() && entry.path().extension() == ".matrix") {
+				files.push_back(entry.path());
+			}
+		}
+	}
+
+	// A single file is verified chunk-parallel and multiple files file-parallel
+	const auto total_threads = mtk::matfile::matrix_market::detail::get_num_threads(num_threads);
+	const auto threads_per_file = files.size() == 1 ? total_threads : 1u;
+	unsigned num_failed = 0;
+	unsigned num_skipped = 0;
+MATFILE_OMP(omp parallel for schedule(dynamic, 1) reduction(+: num_failed, num_skipped) num_threads(total_threads))
+	for (std::size_t i = 0; i < files.size(); i++) {
+		std::string message;
+		bool skipped = false;
+		try {
+			skipped = !has_checksum(files[i].string());
+			if (!skipped) {
+				message = verify(files[i].string(), threads_per_file);
+			}
+		} catch (const std::exception& e) {
+			message = e.what();
+		}
+		if (skipped) {
+			std::printf("%s : skipped (no checksum)\n", files[i].c_str());
+			num_skipped++;
+		} else if (message.empty()) {
+			std::printf("%s : OK\n", files[i].c_str());
+		} else {
+			std::printf("%s : %s\n", files[i].c_str(), message.c_str());
+			num_failed++;
+		}
+	}
+	if (files.size() > 1) {
+		std::printf("%lu / %lu intact, %u skipped\n", files.size() - num_failed - num_skipped, files.size() - num_skipped, num_skipped);
+	}
+	return num_failed == 0 ? 0 : 1;
+}